@@ -0,0 +1,196 @@
+//bloom_filter.cpp - Bloom过滤器实现
+
+#include "bloom_filter.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+using namespace std;
+namespace fs = filesystem;
+
+namespace
+{
+    constexpr uint64_t kBitsPerKey = 10;
+    constexpr uint32_t kHashes = 7;
+    constexpr uint64_t kMinKeys = 1024;
+
+    // 已加载的过滤器,键为文件路径
+    map<string, unique_ptr<BloomFilter>> cache;
+
+    string filterPath(const string &base, const string &column)
+    {
+        return base + "." + column + ".bloom";
+    }
+
+    uint64_t fileSize(const string &path)
+    {
+        error_code ec;
+        uint64_t size = fs::file_size(path, ec);
+        return ec ? 0 : size;
+    }
+
+    void putFixed(string &out, uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+
+    uint64_t getFixed(const string &in, size_t pos)
+    {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            v |= static_cast<uint64_t>(static_cast<unsigned char>(in[pos + i])) << (8 * i);
+        return v;
+    }
+}
+
+BloomFilter::BloomFilter(uint64_t expectedKeys)
+    : expected(max(expectedKeys, kMinKeys))
+{
+    words.assign((expected * kBitsPerKey + 63) / 64, 0);
+}
+
+// FNV-1a后再做一次混合,高低32位分别作为双重哈希的两个基
+uint64_t BloomFilter::hash(const string &key)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void BloomFilter::addHash(uint64_t h)
+{
+    uint64_t bits = words.size() * 64;
+    uint64_t a = h & 0xffffffff, b = (h >> 32) | 1;
+    for (uint32_t i = 0; i < kHashes; ++i)
+    {
+        uint64_t bit = (a + i * b) % bits;
+        words[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+    ++keys;
+}
+
+bool BloomFilter::mightContain(const string &key) const
+{
+    uint64_t h = hash(key);
+    uint64_t bits = words.size() * 64;
+    uint64_t a = h & 0xffffffff, b = (h >> 32) | 1;
+    for (uint32_t i = 0; i < kHashes; ++i)
+    {
+        uint64_t bit = (a + i * b) % bits;
+        if (!(words[bit >> 6] & (uint64_t(1) << (bit & 63))))
+            return false;
+    }
+    return true;
+}
+
+/*
+文件格式(小端):
+  "MDBBLM1\n"  uint64 覆盖的.tbl字节数  uint64 .seg字节数  uint64 容量  uint64 键数  uint64 位数组字数
+  之后为位数组
+*/
+bool BloomFilter::save(const string &filePath) const
+{
+    string out("MDBBLM1\n");
+    putFixed(out, tailBytes);
+    putFixed(out, segmentBytes);
+    putFixed(out, expected);
+    putFixed(out, keys);
+    putFixed(out, words.size());
+    for (uint64_t w : words)
+        putFixed(out, w);
+
+    // 先写临时文件再重命名,避免留下半个过滤器
+    string tmp = filePath + ".tmp";
+    {
+        ofstream fout(tmp, ios::binary | ios::trunc);
+        if (!fout.write(out.data(), out.size()))
+            return false;
+    }
+    error_code ec;
+    fs::rename(tmp, filePath, ec);
+    return !ec;
+}
+
+bool BloomFilter::load(const string &filePath)
+{
+    ifstream fin(filePath, ios::binary);
+    string in((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+    if (in.size() < 48 || in.compare(0, 8, "MDBBLM1\n") != 0)
+        return false;
+    uint64_t count = getFixed(in, 40);
+    if (count == 0 || in.size() != 48 + count * 8)
+        return false;
+    tailBytes = getFixed(in, 8);
+    segmentBytes = getFixed(in, 16);
+    expected = getFixed(in, 24);
+    keys = getFixed(in, 32);
+    words.resize(count);
+    for (uint64_t i = 0; i < count; ++i)
+        words[i] = getFixed(in, 48 + i * 8);
+    dirty = false;
+    return true;
+}
+
+BloomFilter *BloomManager::find(const string &base, const string &column)
+{
+    string path = filterPath(base, column);
+    auto it = cache.find(path);
+    if (it == cache.end())
+    {
+        auto filter = make_unique<BloomFilter>();
+        if (!filter->load(path))
+            filter.reset();
+        it = cache.emplace(path, move(filter)).first;
+    }
+    BloomFilter *filter = it->second.get();
+    if (!filter)
+        return nullptr;
+
+    // 压缩段被改写或文本尾部被截短后过滤器不再可信
+    if (fileSize(base + ".seg") != filter->segmentBytes || fileSize(base + ".tbl") < filter->tailBytes)
+    {
+        it->second.reset();
+        fs::remove(path);
+        return nullptr;
+    }
+    return filter;
+}
+
+bool BloomManager::store(const string &base, const string &column, BloomFilter filter)
+{
+    string path = filterPath(base, column);
+    filter.dirty = false;
+    bool ok = filter.save(path);
+    cache[path] = make_unique<BloomFilter>(move(filter));
+    return ok;
+}
+
+void BloomManager::forget(const string &base, const vector<string> &columns)
+{
+    for (const auto &column : columns)
+    {
+        string path = filterPath(base, column);
+        cache.erase(path);
+        fs::remove(path);
+    }
+}
+
+void BloomManager::flush()
+{
+    for (auto &[path, filter] : cache)
+    {
+        if (filter && filter->dirty && filter->save(path))
+            filter->dirty = false;
+    }
+}
@@ -0,0 +1,48 @@
+//bloom_filter.h - Bloom过滤器头文件
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Bloom过滤器,判断一个值是否一定不在存储单元中;按每个键10位、7个哈希函数设计,误判率约1%
+class BloomFilter
+{
+public:
+    explicit BloomFilter(uint64_t expectedKeys = 0);
+
+    static uint64_t hash(const string &key);
+    void add(const string &key) { addHash(hash(key)); }
+    void addHash(uint64_t h);
+    bool mightContain(const string &key) const;
+
+    uint64_t keyCount() const { return keys; }
+    uint64_t capacity() const { return expected; }
+
+    bool save(const string &filePath) const;
+    bool load(const string &filePath);
+
+    uint64_t tailBytes = 0;    // 已覆盖的文本尾部(.tbl)前缀字节数,之后追加的记录需要补充
+    uint64_t segmentBytes = 0; // 建立时压缩段(.seg)的大小,不一致说明压缩段已被改写
+    bool dirty = false;        // 内存中的内容比文件新
+
+private:
+    vector<uint64_t> words;
+    uint64_t expected = 0;
+    uint64_t keys = 0;
+};
+
+// 管理各存储单元的过滤器文件<base>.<column>.bloom,加载后缓存在内存中,插入时在内存中更新
+class BloomManager
+{
+public:
+    // 取得存储单元base上column列的过滤器,不存在或与数据文件不一致时返回nullptr
+    static BloomFilter *find(const string &base, const string &column);
+    // 保存新建立的过滤器
+    static bool store(const string &base, const string &column, BloomFilter filter);
+    // 删除存储单元base的全部过滤器文件及缓存
+    static void forget(const string &base, const vector<string> &columns);
+    // 把插入时更新过的过滤器写回文件
+    static void flush();
+};
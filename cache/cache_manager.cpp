@@ -0,0 +1,183 @@
+//cache_manager.cpp - 查询结果缓存实现
+
+#include "cache_manager.h"
+#include "../stats/stats_manager.h"
+#include <algorithm>
+#include <cctype>
+#include <list>
+#include <map>
+#include <unordered_map>
+using namespace std;
+
+namespace
+{
+    struct Entry
+    {
+        string key;
+        string table;
+        uint64_t version = 0; // 缓存时表的写入版本
+        uint64_t bytes = 0;
+        RowBatch rows;
+    };
+
+    uint64_t budget = 0;
+    uint64_t used = 0;
+    list<Entry> lru; // 表头为最近使用的结果
+    unordered_map<string, list<Entry>::iterator> index;
+    map<string, uint64_t> versions; // 各表的写入版本,只在本进程内有意义
+
+    uint64_t versionOf(const string &tableName)
+    {
+        auto it = versions.find(tableName);
+        return it == versions.end() ? 0 : it->second;
+    }
+
+    // 结果占用的内存:批的缓冲区与位置表加上条目本身的开销
+    uint64_t footprint(const string &key, const RowBatch &rows)
+    {
+        return sizeof(Entry) + key.size() * 2 + rows.bytes(); // 键在链表和索引中各存一份
+    }
+
+    void erase(list<Entry>::iterator it)
+    {
+        used -= it->bytes;
+        index.erase(it->key);
+        lru.erase(it);
+    }
+
+    void evict(uint64_t limit)
+    {
+        while (used > limit && !lru.empty())
+            erase(prev(lru.end()));
+    }
+
+    string trimmed(const string &s)
+    {
+        size_t begin = s.find_first_not_of(" \t\r\n");
+        if (begin == string::npos)
+            return "";
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    // 双引号外的连续空白合并为一个空格,双引号内的内容保持原样
+    string normalize(const string &s)
+    {
+        string out;
+        bool inQuote = false, space = false;
+        for (char c : trimmed(s))
+        {
+            if (inQuote)
+            {
+                out.push_back(c);
+                inQuote = c != '"';
+                continue;
+            }
+            if (isspace(static_cast<unsigned char>(c)))
+            {
+                space = true;
+                continue;
+            }
+            if (space && !out.empty())
+                out.push_back(' ');
+            space = false;
+            inQuote = c == '"';
+            out.push_back(c);
+        }
+        return out;
+    }
+}
+
+void CacheManager::setBudget(uint64_t bytes)
+{
+    budget = bytes;
+    evict(budget);
+}
+
+bool CacheManager::enabled()
+{
+    return budget > 0;
+}
+
+string CacheManager::statementKey(const SelectCommand &select)
+{
+    // 表名、列名和条件值区分大小写(与目录和比较方式一致),聚合函数名和AS不区分;各部分以\x1f分隔
+    string key = normalize(select.tableName);
+    key += '\x1f';
+    for (const auto &column : select.columns)
+    {
+        string item = normalize(column);
+        size_t open = item.find('(');
+        if (open != string::npos)
+            transform(item.begin(), item.begin() + open, item.begin(), ::tolower);
+        string lowered = item;
+        transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+        size_t asPos = lowered.rfind(" as ");
+        if (asPos != string::npos)
+            item.replace(asPos, 4, " as ");
+        key += item + ',';
+    }
+    key += '\x1f';
+    // 条件值只去掉首尾空白,中间的空白是值的一部分,合并后会让不同的值共用同一条缓存
+    size_t eq = select.condition.find('=');
+    if (eq != string::npos)
+        key += normalize(select.condition.substr(0, eq)) + '=' + trimmed(select.condition.substr(eq + 1));
+    else
+        key += trimmed(select.condition);
+    key += '\x1f';
+    for (const auto &column : select.groupBy)
+        key += normalize(column) + ',';
+    return key;
+}
+
+bool CacheManager::lookup(const string &key, const string &tableName, RowBatch &rows)
+{
+    if (!enabled())
+        return false;
+    auto it = index.find(key);
+    if (it == index.end() || it->second->table != tableName || it->second->version != versionOf(tableName))
+    {
+        // 表已被写入过的结果不会再命中,直接丢弃
+        if (it != index.end())
+            erase(it->second);
+        StatsManager::addCacheMiss();
+        return false;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    rows = it->second->rows.clone();
+    StatsManager::addCacheHit();
+    return true;
+}
+
+void CacheManager::store(const string &key, const string &tableName, const RowBatch &rows)
+{
+    if (!enabled())
+        return;
+    auto it = index.find(key);
+    if (it != index.end())
+        erase(it->second);
+    // 单个结果超过预算时不缓存;复制时缓冲区按实际大小分配,占用按副本计算
+    RowBatch copy = rows.clone();
+    uint64_t bytes = footprint(key, copy);
+    if (bytes > budget)
+        return;
+    evict(budget - bytes);
+    lru.push_front(Entry{key, tableName, versionOf(tableName), bytes, move(copy)});
+    index[key] = lru.begin();
+    used += bytes;
+}
+
+void CacheManager::bumpVersion(const string &tableName)
+{
+    ++versions[tableName];
+}
+
+size_t CacheManager::entryCount()
+{
+    return lru.size();
+}
+
+uint64_t CacheManager::usedBytes()
+{
+    return used;
+}
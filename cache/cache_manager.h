@@ -0,0 +1,33 @@
+//cache_manager.h - 查询结果缓存头文件
+
+#pragma once
+#include "../common/command.h"
+#include "../common/row_batch.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// SELECT结果缓存,默认关闭。键为规范化后的语句,每条结果记录其所查表的写入版本,
+// 表被插入、删除、更新或删除后版本加一,旧结果随之失效;总大小超过预算时淘汰最久未使用的结果
+class CacheManager
+{
+public:
+    // 设置缓存的字节预算,0表示关闭缓存并清空已缓存的结果
+    static void setBudget(uint64_t bytes);
+    static bool enabled();
+
+    // 由解析后的语句各部分生成缓存键,关键字大小写和列名中多余的空白不影响键,条件值除首尾空白外原样保留
+    static string statementKey(const SelectCommand &select);
+
+    // 查找结果,命中且表未被写入过时返回true;缓存开启时计入命中/未命中次数
+    static bool lookup(const string &key, const string &tableName, RowBatch &rows);
+    static void store(const string &key, const string &tableName, const RowBatch &rows);
+
+    // 表的内容发生变化
+    static void bumpVersion(const string &tableName);
+
+    // 当前缓存的结果数与占用字节数
+    static size_t entryCount();
+    static uint64_t usedBytes();
+};
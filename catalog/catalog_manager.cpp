@@ -1,42 +1,689 @@
 //catalog_manager.cpp - 目录管理器实现
 
 #include "catalog_manager.h"
+#include "../bloom/bloom_filter.h"
+#include "../cache/cache_manager.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
 using namespace std;
 namespace fs = filesystem;
 
-//在metadata目录下创建表的元数据文件，记录表的结构信息
-bool CatalogManager::createTable(const string &tableName, const vector<pair<string, string>> &columns)
+//目录中记录的一张表的全部信息
+struct TableMeta
 {
-    // 若metadata目录不存在进行创建
-    fs::create_directory("metadata");
+    vector<pair<string, string>> columns;
+    PartitionSpec partition;
+    vector<string> blooms;
+    string storage;
+    vector<string> views; // 依赖该表的物化视图
+    string viewSource;    // 物化视图的基表
+    string viewQuery;     // 物化视图的定义
+};
 
-    // 生成元数据文件路径
-    string filename = "metadata/" + tableName + ".meta";
-    ofstream fout(filename);
-    if (!fout.is_open())
+/*
+目录文件metadata/catalog.bin格式(小端):
+  "MDBCAT1\n"  uint64 版本  uint64 内容字节数  uint64 内容的校验和(FNV-1a)
+  内容:uint32 表数,之后每张表依次为
+    表名  存储引擎  物化视图的基表  物化视图的定义
+    uint32 列数,每列:列名 类型
+    分区方式 分区列 uint32 分区数,每个分区:uint32 编号 上界(HASH分区为空)
+    uint32 Bloom列数,每列:列名
+    uint32 物化视图数,每个:视图名
+  之后是uint32 待清理数,每项为已删除的表名或分区名(<table>.p<id>),其文件尚未确认删除
+  字符串均为uint32长度后跟内容
+每次改动都写出完整的新版本到临时文件,同步到磁盘后再重命名,文件要么是旧版本要么是新版本,不会只写了一半
+替换前把旧版本保留为catalog.bin.prev,目录文件校验失败时改用它
+*/
+namespace
+{
+    const string kCatalogPath = "metadata/catalog.bin";
+    const string kPrevPath = kCatalogPath + ".prev";
+    const string kMagic = "MDBCAT1\n";
+    constexpr size_t kHeaderBytes = 32;
+
+    mutex mu;                      // 保护以下全部状态
+    map<string, TableMeta> tables; // 启动时从目录文件一次读入,之后只在内存中查询
+    vector<string> pendingDrops;   // 已从目录删除、文件可能还在的表和分区,启动时只清理这些文件
+    uint64_t version = 0;          // 目录文件的版本,每次写回加一
+    bool loaded = false;
+    bool loadFailed = false; // 目录文件和上一版本都损坏时不再写回,以免覆盖
+    bool usedPrev = false;   // 目录文件损坏而读入了上一版本,下次写回时不能用损坏的文件替换上一版本
+
+    void putFixed(string &out, uint64_t v, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+
+    void putString(string &out, const string &s)
+    {
+        putFixed(out, s.size(), 4);
+        out += s;
+    }
+
+    // 顺序读取目录内容,越界时置ok为false并返回空值
+    struct Reader
+    {
+        const string &in;
+        size_t pos = 0;
+        bool ok = true;
+
+        uint64_t fixed(int bytes)
+        {
+            if (!ok || in.size() - pos < static_cast<size_t>(bytes))
+            {
+                ok = false;
+                return 0;
+            }
+            uint64_t v = 0;
+            for (int i = 0; i < bytes; ++i)
+                v |= static_cast<uint64_t>(static_cast<unsigned char>(in[pos + i])) << (8 * i);
+            pos += bytes;
+            return v;
+        }
+
+        string str()
+        {
+            uint64_t len = fixed(4);
+            if (!ok || in.size() - pos < len)
+            {
+                ok = false;
+                return "";
+            }
+            string s = in.substr(pos, len);
+            pos += len;
+            return s;
+        }
+    };
+
+    uint64_t checksum(const string &data)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : data)
+        {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    string encode(const map<string, TableMeta> &all, const vector<string> &drops)
+    {
+        string out;
+        putFixed(out, all.size(), 4);
+        for (const auto &[name, meta] : all)
+        {
+            putString(out, name);
+            putString(out, meta.storage);
+            putString(out, meta.viewSource);
+            putString(out, meta.viewQuery);
+            putFixed(out, meta.columns.size(), 4);
+            for (const auto &[column, type] : meta.columns)
+            {
+                putString(out, column);
+                putString(out, type);
+            }
+            const PartitionSpec &partition = meta.partition;
+            putString(out, partition.method);
+            putString(out, partition.column);
+            putFixed(out, partition.ids.size(), 4);
+            for (size_t i = 0; i < partition.ids.size(); ++i)
+            {
+                putFixed(out, static_cast<uint32_t>(partition.ids[i]), 4);
+                putString(out, i < partition.bounds.size() ? partition.bounds[i] : "");
+            }
+            putFixed(out, meta.blooms.size(), 4);
+            for (const auto &column : meta.blooms)
+                putString(out, column);
+            putFixed(out, meta.views.size(), 4);
+            for (const auto &view : meta.views)
+                putString(out, view);
+        }
+        putFixed(out, drops.size(), 4);
+        for (const auto &name : drops)
+            putString(out, name);
+        return out;
+    }
+
+    bool decode(const string &content, map<string, TableMeta> &all, vector<string> &drops)
+    {
+        Reader in{content};
+        uint64_t count = in.fixed(4);
+        for (uint64_t t = 0; t < count && in.ok; ++t)
+        {
+            string name = in.str();
+            TableMeta &meta = all[name];
+            meta.storage = in.str();
+            meta.viewSource = in.str();
+            meta.viewQuery = in.str();
+            uint64_t columns = in.fixed(4);
+            for (uint64_t c = 0; c < columns && in.ok; ++c)
+            {
+                string column = in.str();
+                meta.columns.emplace_back(column, in.str());
+            }
+            PartitionSpec &partition = meta.partition;
+            partition.method = in.str();
+            partition.column = in.str();
+            uint64_t ids = in.fixed(4);
+            for (uint64_t i = 0; i < ids && in.ok; ++i)
+            {
+                partition.ids.push_back(static_cast<int>(in.fixed(4)));
+                string bound = in.str();
+                if (partition.method == "range")
+                    partition.bounds.push_back(bound);
+            }
+            uint64_t blooms = in.fixed(4);
+            for (uint64_t i = 0; i < blooms && in.ok; ++i)
+                meta.blooms.push_back(in.str());
+            uint64_t views = in.fixed(4);
+            for (uint64_t i = 0; i < views && in.ok; ++i)
+                meta.views.push_back(in.str());
+        }
+        // 较早的目录文件没有待清理列表
+        if (in.ok && in.pos < content.size())
+        {
+            uint64_t count = in.fixed(4);
+            for (uint64_t i = 0; i < count && in.ok; ++i)
+                drops.push_back(in.str());
+        }
+        return in.ok && in.pos == content.size();
+    }
+
+    //把文件(或目录)已写入的内容同步到磁盘
+    bool syncPath(const string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+
+    //读入并校验一个目录文件,文件不存在时exists为false
+    bool readCatalog(const string &path, bool &exists, uint64_t &fileVersion, map<string, TableMeta> &all, vector<string> &drops)
+    {
+        ifstream fin(path, ios::binary);
+        exists = fin.is_open();
+        if (!exists)
+            return false;
+        string in((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+        Reader header{in};
+        bool ok = in.size() >= kHeaderBytes && in.compare(0, kMagic.size(), kMagic) == 0;
+        header.pos = kMagic.size();
+        fileVersion = header.fixed(8);
+        uint64_t length = header.fixed(8);
+        uint64_t sum = header.fixed(8);
+        string content = ok && in.size() - kHeaderBytes == length ? in.substr(kHeaderBytes) : "";
+        all.clear();
+        drops.clear();
+        return ok && in.size() - kHeaderBytes == length && checksum(content) == sum && decode(content, all, drops);
+    }
+
+    // 把all和drops写为下一个版本的目录文件,成功后才替换内存中的目录
+    bool commit(map<string, TableMeta> all, vector<string> drops)
+    {
+        if (loadFailed)
+            return false;
+        string content = encode(all, drops);
+        string out = kMagic;
+        putFixed(out, version + 1, 8);
+        putFixed(out, content.size(), 8);
+        putFixed(out, checksum(content), 8);
+        out += content;
+
+        // 若metadata目录不存在进行创建
+        fs::create_directory("metadata");
+        string tmp = kCatalogPath + ".tmp";
+        {
+            ofstream fout(tmp, ios::binary | ios::trunc);
+            if (!fout.write(out.data(), out.size()))
+                return false;
+            fout.close();
+            if (fout.fail() || !syncPath(tmp))
+                return false;
+        }
+        // 当前版本硬链接为上一版本后再替换,文件系统不支持硬链接时复制
+        error_code ec;
+        if (!usedPrev && fs::exists(kCatalogPath, ec))
+        {
+            fs::remove(kPrevPath, ec);
+            fs::create_hard_link(kCatalogPath, kPrevPath, ec);
+            if (ec)
+                fs::copy_file(kCatalogPath, kPrevPath, fs::copy_options::overwrite_existing, ec);
+            if (ec)
+                return false;
+        }
+        fs::rename(tmp, kCatalogPath, ec);
+        if (ec || !syncPath("metadata"))
+            return false;
+        usedPrev = false;
+        ++version;
+        tables = move(all);
+        pendingDrops = move(drops);
+        return true;
+    }
+
+    bool commit(map<string, TableMeta> all)
+    {
+        return commit(move(all), pendingDrops);
+    }
+
+    //name是否为表tableName或它的某个分区
+    bool belongsTo(const string &name, const string &tableName)
+    {
+        return name.compare(0, tableName.size(), tableName) == 0 &&
+               (name.size() == tableName.size() || name[tableName.size()] == '.');
+    }
+
+    //去掉表tableName及其分区的待清理项,用于以同名重新建表
+    vector<string> dropsExcept(const string &tableName)
+    {
+        vector<string> drops;
+        for (const auto &name : pendingDrops)
+        {
+            if (!belongsTo(name, tableName))
+                drops.push_back(name);
+        }
+        return drops;
+    }
+
+    //解析旧版的文本元数据文件:表名行之后依次为可选的Storage、View、Partition、Bloom、Views行,最后是Columns及各列
+    bool parseMetaFile(const string &path, TableMeta &meta)
+    {
+        ifstream fin(path);
+        string line;
+        bool inColumns = false;
+        while (getline(fin, line))
+        {
+            if (inColumns)
+            {
+                if (line.empty())
+                    break;
+                stringstream ss(line);
+                string colName, colType;
+                ss >> colName >> colType;
+                meta.columns.emplace_back(colName, colType);
+                continue;
+            }
+            if (line.find("Columns:") != string::npos)
+            {
+                inColumns = true;
+                continue;
+            }
+            stringstream ss;
+            if (line.find("Storage:") == 0)
+            {
+                ss.str(line.substr(8));
+                ss >> meta.storage;
+            }
+            else if (line.find("View:") == 0)
+            {
+                ss.str(line.substr(5));
+                ss >> meta.viewSource;
+                getline(ss >> ws, meta.viewQuery);
+            }
+            else if (line.find("Partition:") == 0)
+            {
+                ss.str(line.substr(10));
+                ss >> meta.partition.method >> meta.partition.column;
+                string token;
+                while (ss >> token)
+                {
+                    size_t colon = token.find(':');
+                    meta.partition.ids.push_back(atoi(token.substr(0, colon).c_str()));
+                    if (colon != string::npos)
+                        meta.partition.bounds.push_back(token.substr(colon + 1));
+                }
+            }
+            else if (line.find("Bloom:") == 0 || line.find("Views:") == 0)
+            {
+                ss.str(line.substr(6));
+                vector<string> &names = line[0] == 'B' ? meta.blooms : meta.views;
+                string name;
+                while (ss >> name)
+                    names.push_back(name);
+            }
+        }
+        return !meta.columns.empty();
+    }
+
+    //本系统产生的文件是否属于待清理的表或分区name:文件名以"<name>."开头且后缀是本系统使用的
+    bool isDroppedFile(const fs::path &path, const string &name)
+    {
+        static const vector<string> kSuffixes = {".tbl", ".seg", ".bloom", ".wal", ".lsm", ".run", ".mv", ".stats", ".tmp"};
+        string ext = path.extension().string();
+        if (find(kSuffixes.begin(), kSuffixes.end(), ext) == kSuffixes.end())
+            return false;
+        string file = path.filename().string();
+        return file.size() > name.size() && belongsTo(file, name);
+    }
+
+    //删除目录中记录为待清理的表和分区留下的文件,如删除表时在写回目录之后、删除数据文件之前崩溃
+    //只删除这些确知已删除的表和分区的文件,不认识的文件一律保留
+    void removeDropped()
+    {
+        vector<string> drops;
+        for (const auto &name : pendingDrops)
+        {
+            // 仍在目录中的表和分区不清理(建同名表时已去掉对应的待清理项,这里只是防御)
+            size_t dot = name.find('.');
+            auto it = tables.find(name.substr(0, dot));
+            bool live = it != tables.end();
+            if (live && dot != string::npos)
+            {
+                const vector<int> &ids = it->second.partition.ids;
+                live = find(ids.begin(), ids.end(), atoi(name.c_str() + dot + 2)) != ids.end();
+            }
+            if (!live)
+                drops.push_back(name);
+        }
+        if (drops.empty())
+            return;
+        error_code ec;
+        for (const string dir : {"data", "metadata"})
+        {
+            vector<fs::path> dropped;
+            for (const auto &entry : fs::directory_iterator(dir, ec))
+            {
+                for (const auto &name : drops)
+                {
+                    if (isDroppedFile(entry.path(), name))
+                    {
+                        dropped.push_back(entry.path());
+                        break;
+                    }
+                }
+            }
+            for (const auto &path : dropped)
+                fs::remove(path, ec);
+        }
+        // 文件删完后清空待清理列表,写不出目录时保留,下次启动再清理
+        commit(tables, {});
+    }
+
+    //读入目录文件(损坏时读入上一版本),并入旧版的.meta文件后删除它们,最后清理待清理的表和分区留下的文件
+    bool loadLocked()
+    {
+        loaded = true;
+        map<string, TableMeta> all;
+        vector<string> drops;
+        bool exists = false, prevExists = false;
+        uint64_t fileVersion = 0;
+        if (readCatalog(kCatalogPath, exists, fileVersion, all, drops))
+            version = fileVersion;
+        else if (exists)
+        {
+            if (!readCatalog(kPrevPath, prevExists, fileVersion, all, drops))
+            {
+                loadFailed = true;
+                return false;
+            }
+            usedPrev = true;
+            version = fileVersion;
+        }
+        tables = all;
+        pendingDrops = drops;
+
+        // 旧版每张表一个metadata/<table>.meta,目录中没有的表并入目录,写回成功后删除这些文件
+        vector<fs::path> metaFiles;
+        error_code ec;
+        for (const auto &entry : fs::directory_iterator("metadata", ec))
+        {
+            if (entry.path().extension() == ".meta")
+                metaFiles.push_back(entry.path());
+        }
+        bool imported = false;
+        for (const auto &path : metaFiles)
+        {
+            string name = path.stem().string();
+            TableMeta meta;
+            if (all.count(name) == 0 && parseMetaFile(path.string(), meta))
+            {
+                all[name] = meta;
+                imported = true;
+            }
+        }
+        if (imported && !commit(all))
+        {
+            // 写不出目录文件时本次仍按并入后的目录使用,保留.meta文件下次启动再并入
+            tables = move(all);
+            return true;
+        }
+        for (const auto &path : metaFiles)
+            fs::remove(path, ec);
+
+        removeDropped();
+        return true;
+    }
+
+    //首次访问目录时读入,调用方须持有mu
+    void ensureLoaded()
+    {
+        if (!loaded)
+            loadLocked();
+    }
+
+    const TableMeta *findTable(const string &tableName)
+    {
+        ensureLoaded();
+        auto it = tables.find(tableName);
+        return it == tables.end() ? nullptr : &it->second;
+    }
+}
+
+bool CatalogManager::load()
+{
+    lock_guard<mutex> lock(mu);
+    if (!loaded)
+        loadLocked();
+    return !loadFailed;
+}
+
+bool CatalogManager::recoveredFromPrevious()
+{
+    lock_guard<mutex> lock(mu);
+    return usedPrev;
+}
+
+//在目录中登记新表，记录表的结构信息
+bool CatalogManager::createTable(const string &tableName, const vector<pair<string, string>> &columns,
+                                 const PartitionSpec &partition, const string &storage)
+{
+    // 目前只支持LSM一种可选引擎,LSM表以第一列为键,不能再分区
+    if (!storage.empty() && (storage != "lsm" || !partition.method.empty() || columns.empty()))
         return false;
 
-    // 写入表名
-    fout << "Table: " << tableName << "\n";
+    // 分区列必须是表中的列,且至少有一个分区
+    if (!partition.method.empty())
+    {
+        bool found = any_of(columns.begin(), columns.end(), [&](const pair<string, string> &c)
+                            { return c.first == partition.column; });
+        if (!found || partition.ids.empty())
+            return false;
+        if (partition.method == "range" && partition.bounds.size() != partition.ids.size())
+            return false;
+    }
+    lock_guard<mutex> lock(mu);
+    if (findTable(tableName))
+        return false;
+    TableMeta meta;
+    meta.columns = columns;
+    meta.partition = partition;
+    meta.storage = storage;
+    map<string, TableMeta> next = tables;
+    next[tableName] = meta;
+    return commit(move(next), dropsExcept(tableName));
+}
+
+//物化视图登记为storage为view的表,并把视图名记录到基表中,两处改动写在同一个目录版本里
+bool CatalogManager::createView(const string &viewName, const vector<pair<string, string>> &columns,
+                                const string &sourceTable, const string &query)
+{
+    // 视图不能与已有的表重名,基表必须存在且不能是物化视图
+    lock_guard<mutex> lock(mu);
+    const TableMeta *source = findTable(sourceTable);
+    if (columns.empty() || findTable(viewName) || !source || source->storage == "view")
+        return false;
+
+    TableMeta meta;
+    meta.columns = columns;
+    meta.storage = "view";
+    meta.viewSource = sourceTable;
+    meta.viewQuery = query;
+    map<string, TableMeta> next = tables;
+    next[viewName] = meta;
+    next[sourceTable].views.push_back(viewName);
+    return commit(move(next), dropsExcept(viewName));
+}
+
+bool CatalogManager::dropTable(const string &tableName)
+{
+    TableMeta meta;
+    {
+        lock_guard<mutex> lock(mu);
+        const TableMeta *found = findTable(tableName);
+        if (!found)
+            return false;
+        meta = *found;
 
-    // 写入各列名与数据类型
-    fout << "Columns:\n";
-    for (const auto &[name, type] : columns)
+        // 删除物化视图时从基表中去掉该视图
+        map<string, TableMeta> next = tables;
+        next.erase(tableName);
+        auto source = next.find(meta.viewSource);
+        if (!meta.viewSource.empty() && source != next.end())
+        {
+            vector<string> &views = source->second.views;
+            views.erase(remove(views.begin(), views.end(), tableName), views.end());
+        }
+        // 先写回目录并记下待清理,再删除文件,中途崩溃留下的文件在下次启动时清除
+        vector<string> drops = dropsExcept(tableName);
+        drops.push_back(tableName);
+        if (!commit(move(next), move(drops)))
+            return false;
+    }
+
+    // 删除数据文件(含各分区的数据文件)
+    vector<string> bases = {"data/" + tableName};
+    for (int id : meta.partition.ids)
+        bases.push_back("data/" + tableName + ".p" + to_string(id));
+    for (const auto &base : bases)
     {
-        fout << name << " " << type << "\n";
+        std::filesystem::remove(base + ".tbl");
+        std::filesystem::remove(base + ".seg");
+        BloomManager::forget(base, meta.blooms);
     }
-    fout.close();
+    CacheManager::bumpVersion(tableName);
     return true;
 }
 
-bool CatalogManager::dropTable(const string &tableName)
+bool CatalogManager::dropPartition(const string &tableName, int partitionId)
 {
-    // 删除元数据文件与数据文件
-    string metaFile = "metadata/" + tableName + ".meta";
-    string dataFile = "data/" + tableName + ".tbl";
-    bool metaRemoved = std::filesystem::remove(metaFile);
-    bool dataRemoved = std::filesystem::remove(dataFile);
-    return metaRemoved || dataRemoved;
+    // HASH分区的分区数决定了记录的去向,不能单独删除
+    vector<string> blooms;
+    {
+        lock_guard<mutex> lock(mu);
+        const TableMeta *found = findTable(tableName);
+        if (!found || found->partition.method != "range")
+            return false;
+        map<string, TableMeta> next = tables;
+        PartitionSpec &partition = next[tableName].partition;
+        auto it = find(partition.ids.begin(), partition.ids.end(), partitionId);
+        if (it == partition.ids.end())
+            return false;
+        size_t pos = it - partition.ids.begin();
+        partition.ids.erase(partition.ids.begin() + pos);
+        partition.bounds.erase(partition.bounds.begin() + pos);
+        blooms = found->blooms;
+
+        // 先更新目录并记下待清理,再删除数据文件
+        vector<string> drops = pendingDrops;
+        drops.push_back(tableName + ".p" + to_string(partitionId));
+        if (!commit(move(next), move(drops)))
+            return false;
+    }
+    string base = "data/" + tableName + ".p" + to_string(partitionId);
+    std::filesystem::remove(base + ".tbl");
+    std::filesystem::remove(base + ".seg");
+    BloomManager::forget(base, blooms);
+    CacheManager::bumpVersion(tableName);
+    return true;
+}
+
+bool CatalogManager::addBloomFilter(const string &tableName, const string &column)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(tableName);
+    if (!meta)
+        return false;
+    bool found = any_of(meta->columns.begin(), meta->columns.end(), [&](const pair<string, string> &c)
+                        { return c.first == column; });
+    if (!found)
+        return false;
+    if (find(meta->blooms.begin(), meta->blooms.end(), column) != meta->blooms.end())
+        return true;
+    map<string, TableMeta> next = tables;
+    next[tableName].blooms.push_back(column);
+    return commit(move(next));
+}
+
+//读取列名与类型
+vector<pair<string, string>> CatalogManager::getColumns(const string &tableName)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(tableName);
+    return meta ? meta->columns : vector<pair<string, string>>();
+}
+
+//读取分区定义
+PartitionSpec CatalogManager::getPartition(const string &tableName)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(tableName);
+    return meta ? meta->partition : PartitionSpec();
+}
+
+//读取建有Bloom过滤器的列
+vector<string> CatalogManager::getBloomFilters(const string &tableName)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(tableName);
+    return meta ? meta->blooms : vector<string>();
+}
+
+//读取存储引擎,默认存储返回空
+string CatalogManager::getStorage(const string &tableName)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(tableName);
+    return meta ? meta->storage : "";
+}
+
+//读取依赖该表的物化视图
+vector<string> CatalogManager::getViews(const string &tableName)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(tableName);
+    return meta ? meta->views : vector<string>();
+}
+
+//读取物化视图的基表和定义,不是物化视图时返回false
+bool CatalogManager::getViewDefinition(const string &viewName, string &sourceTable, string &query)
+{
+    lock_guard<mutex> lock(mu);
+    const TableMeta *meta = findTable(viewName);
+    if (!meta || meta->viewSource.empty())
+        return false;
+    sourceTable = meta->viewSource;
+    query = meta->viewQuery;
+    return true;
 }
@@ -4,11 +4,49 @@
 #include <string>
 #include <vector>
 using namespace std;
+
+//表分区定义,method为空表示不分区
+struct PartitionSpec
+{
+    string method;         // "range"或"hash"
+    string column;         // 分区列
+    vector<int> ids;       // 各分区编号,分区数据存放在data/<table>.p<id>.tbl
+    vector<string> bounds; // RANGE分区与ids一一对应的上界(不含),"MAXVALUE"表示无上界
+};
+
+//全部表的定义保存在单个目录文件metadata/catalog.bin中,启动时一次读入,之后在内存中查询
+//每次改动写出新版本的目录文件,同步到磁盘后再重命名替换,崩溃后看到的要么是旧版本要么是新版本
 class CatalogManager
 {
 public:
+    //读入目录文件,并入旧版的metadata/<table>.meta文件,清除目录中记为已删除的表和分区留下的文件
+    //首次查询目录时也会自动读入;目录文件校验失败时改用上一版本,两者都失败时返回false,此后不再写回目录
+    static bool load();
+    //目录文件校验失败、读入的是上一版本catalog.bin.prev时返回true
+    static bool recoveredFromPrevious();
    //创建新表
-    static bool createTable(const string &tableName, const vector<pair<string, string>> &columns);
-    //删除表
+    //storage为空表示默认的追加文件存储,"lsm"表示LSM存储;物化视图由createView登记
+    static bool createTable(const string &tableName, const vector<pair<string, string>> &columns,
+                            const PartitionSpec &partition = PartitionSpec(), const string &storage = "");
+    //登记物化视图:视图按普通表存储(storage为view),query为定义它的SELECT语句
+    static bool createView(const string &viewName, const vector<pair<string, string>> &columns,
+                           const string &sourceTable, const string &query);
+    //删除表,删除物化视图时同时从基表中注销
     static bool dropTable(const string &tableName);
+    //删除RANGE分区及其数据,该分区的取值范围并入下一个分区
+    static bool dropPartition(const string &tableName, int partitionId);
+    //读取表的列定义(列名,类型),表不存在时返回空
+    static vector<pair<string, string>> getColumns(const string &tableName);
+    //读取表的分区定义
+    static PartitionSpec getPartition(const string &tableName);
+    //登记在column列上建立Bloom过滤器,列不存在时返回false
+    static bool addBloomFilter(const string &tableName, const string &column);
+    //读取建有Bloom过滤器的列
+    static vector<string> getBloomFilters(const string &tableName);
+    //读取表的存储引擎,默认存储返回空
+    static string getStorage(const string &tableName);
+    //读取依赖该表的物化视图
+    static vector<string> getViews(const string &tableName);
+    //读取物化视图的基表和定义,tableName不是物化视图时返回false
+    static bool getViewDefinition(const string &viewName, string &sourceTable, string &query);
 };
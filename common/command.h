@@ -1,5 +1,6 @@
 // command.h - 命令类定义
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 using namespace std;
@@ -14,6 +15,14 @@ enum class CommandType
     UPDATE,  // 更新数据
     DROP,    // 删除表
     EXPORT,  // 导出表为CSV
+    SHOW_STATS, // 显示运行统计
+    COMPACT, // 压缩表
+    DROP_PARTITION, // 删除分区
+    ANALYZE, // 收集统计信息
+    EXPLAIN, // 显示查询计划
+    CREATE_BLOOM, // 建立Bloom过滤器
+    CREATE_VIEW, // 创建物化视图
+    REFRESH_VIEW, // 重新计算物化视图
     UNKNOWN  // 未知命令
 };
 
@@ -32,22 +41,30 @@ class CreateCommand : public Command//公共继承命令基类
 public:
     string tableName; 
     vector<pair<string, string>> columns; 
+    string partitionMethod;         // PARTITION BY RANGE/HASH,空表示不分区
+    string partitionColumn;         // 分区列
+    vector<string> partitionBounds; // RANGE分区的各上界
+    int partitionCount = 0;         // HASH分区的分区数
+    string storage;                 // WITH (storage = ...)指定的存储引擎,空表示默认
 };
 
-//INSERT INTO
-class InsertCommand : public Command
+//SELECT
+class SelectCommand : public Command
 {
 public:
     string tableName; 
-    vector<string> values; 
+    string condition; 
+    vector<string> columns; // SELECT与FROM之间的列名,为空表示SELECT *
+    vector<string> groupBy; // GROUP BY后的列名
 };
 
-//SELECT
-class SelectCommand : public Command
+//INSERT INTO
+class InsertCommand : public Command
 {
 public:
     string tableName; 
-    string condition; 
+    vector<vector<string>> rows;      // VALUES后的各个元组
+    unique_ptr<SelectCommand> source; // INSERT INTO ... SELECT的查询部分
 };
 
 //DELETE FROM
@@ -81,4 +98,62 @@ class ExportTableCommand : public Command
 public:
     string tableName;
     string filePath;
+    string format = "csv"; // "csv"或"binary"
+};
+
+//SHOW STATS
+class ShowStatsCommand : public Command
+{
+};
+
+//COMPACT TABLE
+class CompactCommand : public Command
+{
+public:
+    string tableName;
+};
+
+//ALTER TABLE ... DROP PARTITION ...
+class DropPartitionCommand : public Command
+{
+public:
+    string tableName;
+    int partitionId = -1;
+};
+
+//ANALYZE <table>
+class AnalyzeCommand : public Command
+{
+public:
+    string tableName;
+};
+
+//EXPLAIN SELECT ...
+class ExplainCommand : public Command
+{
+public:
+    unique_ptr<SelectCommand> query;
+};
+
+//CREATE BLOOM FILTER ON <table>(<column>)
+class CreateBloomCommand : public Command
+{
+public:
+    string tableName;
+    string column;
+};
+
+//CREATE MATERIALIZED VIEW <view> AS SELECT ...
+class CreateViewCommand : public Command
+{
+public:
+    string viewName;
+    string query; // AS之后的SELECT语句原文
+};
+
+//REFRESH MATERIALIZED VIEW <view>
+class RefreshViewCommand : public Command
+{
+public:
+    string viewName;
 };
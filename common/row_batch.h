@@ -0,0 +1,117 @@
+// row_batch.h - 记录批定义
+#pragma once
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+// 一批记录:全部字段连续存放在同一块缓冲区中,另用字段结束位置表和行结束位置表定位
+// 追加记录只在缓冲区和位置表扩容时分配内存,分配次数与批大小的对数相当,与字段数无关
+// 只能移动,需要复制时显式调用clone
+class RowBatch
+{
+public:
+    RowBatch() = default;
+    RowBatch(RowBatch &&) noexcept = default;
+    RowBatch &operator=(RowBatch &&) noexcept = default;
+    RowBatch(const RowBatch &) = delete;
+    RowBatch &operator=(const RowBatch &) = delete;
+
+    RowBatch clone() const
+    {
+        RowBatch copy;
+        copy.data = data;
+        copy.fieldEnds = fieldEnds;
+        copy.rowEnds = rowEnds;
+        return copy;
+    }
+
+    // 逐字段追加一行,最后调用endRow
+    void addField(string_view field)
+    {
+        data.append(field);
+        fieldEnds.push_back(data.size());
+    }
+    void endRow() { rowEnds.push_back(fieldEnds.size()); }
+
+    void addRow(const vector<string> &row)
+    {
+        for (const auto &field : row)
+            addField(field);
+        endRow();
+    }
+
+    // 把另一批记录接在后面
+    void append(const RowBatch &other)
+    {
+        size_t base = data.size(), fields = fieldEnds.size();
+        data += other.data;
+        for (size_t end : other.fieldEnds)
+            fieldEnds.push_back(base + end);
+        for (size_t end : other.rowEnds)
+            rowEnds.push_back(fields + end);
+    }
+
+    void clear()
+    {
+        data.clear();
+        fieldEnds.clear();
+        rowEnds.clear();
+    }
+
+    size_t size() const { return rowEnds.size(); }
+    bool empty() const { return rowEnds.empty(); }
+
+    // 第row行的字段数
+    size_t fieldCount(size_t row) const { return rowEnds[row] - firstField(row); }
+
+    // 第row行第column个字段,不存在时返回空串;返回值在批被修改前有效
+    string_view field(size_t row, size_t column) const
+    {
+        size_t index = firstField(row) + column;
+        if (index >= rowEnds[row])
+            return {};
+        size_t begin = index == 0 ? 0 : fieldEnds[index - 1];
+        return string_view(data).substr(begin, fieldEnds[index] - begin);
+    }
+
+    // 按整数读取字段,不是整数时返回false
+    bool intField(size_t row, size_t column, long long &value) const
+    {
+        string_view f = field(row, column);
+        if (f.empty() || f.size() > 31)
+            return false;
+        char buf[32];
+        f.copy(buf, f.size());
+        buf[f.size()] = '\0';
+        errno = 0;
+        char *end = nullptr;
+        value = strtoll(buf, &end, 10);
+        return errno == 0 && *end == '\0';
+    }
+
+    // 复制出第row行,供仍按vector<string>处理记录的代码使用
+    vector<string> rowAt(size_t row) const
+    {
+        vector<string> result;
+        result.reserve(fieldCount(row));
+        for (size_t c = 0; c < fieldCount(row); ++c)
+            result.emplace_back(field(row, c));
+        return result;
+    }
+
+    // 占用的内存字节数
+    size_t bytes() const
+    {
+        return sizeof(RowBatch) + data.capacity() + (fieldEnds.capacity() + rowEnds.capacity()) * sizeof(size_t);
+    }
+
+private:
+    size_t firstField(size_t row) const { return row == 0 ? 0 : rowEnds[row - 1]; }
+
+    string data;              // 各字段内容依次拼接
+    vector<size_t> fieldEnds; // 每个字段在data中的结束位置
+    vector<size_t> rowEnds;   // 每行最后一个字段之后在fieldEnds中的位置
+};
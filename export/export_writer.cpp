@@ -0,0 +1,343 @@
+//export_writer.cpp - 导出写入器实现
+
+#include "export_writer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+using namespace std;
+namespace fs = filesystem;
+
+namespace
+{
+    constexpr size_t kBatchRows = 4096;
+    constexpr size_t kWriteBufferBytes = 1 << 20;
+
+    // 按RFC 4180转义一个字段;插入时保留的SQL字符串字面量外层双引号不属于值本身,先去掉
+    void appendCsvField(string &out, string_view field)
+    {
+        size_t begin = 0, len = field.size();
+        if (len >= 2 && field.front() == '"' && field.back() == '"')
+        {
+            begin = 1;
+            len -= 2;
+        }
+        bool needsQuote = len > 0 && (isspace(static_cast<unsigned char>(field[begin])) ||
+                                      isspace(static_cast<unsigned char>(field[begin + len - 1])));
+        for (size_t i = begin; i < begin + len && !needsQuote; ++i)
+        {
+            char c = field[i];
+            needsQuote = c == ',' || c == '"' || c == '\n' || c == '\r';
+        }
+        if (!needsQuote)
+        {
+            out.append(field.substr(begin, len));
+            return;
+        }
+        out.push_back('"');
+        for (size_t i = begin; i < begin + len; ++i)
+        {
+            if (field[i] == '"')
+                out.push_back('"');
+            out.push_back(field[i]);
+        }
+        out.push_back('"');
+    }
+
+    void appendCsvRow(string &out, const vector<string> &row)
+    {
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            appendCsvField(out, row[i]);
+            if (i != row.size() - 1)
+                out.push_back(',');
+        }
+        out.push_back('\n');
+    }
+
+    string formatBatch(const RowBatch &rows)
+    {
+        string out;
+        for (size_t r = 0; r < rows.size(); ++r)
+        {
+            size_t count = rows.fieldCount(r);
+            for (size_t i = 0; i < count; ++i)
+            {
+                appendCsvField(out, rows.field(r, i));
+                if (i != count - 1)
+                    out.push_back(',');
+            }
+            out.push_back('\n');
+        }
+        return out;
+    }
+
+    void putFixed(string &out, uint64_t v, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+
+    uint64_t align8(uint64_t v)
+    {
+        return (v + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    bool parseInt(const string &s, int64_t &out)
+    {
+        if (s.empty())
+            return false;
+        errno = 0;
+        char *end = nullptr;
+        long long v = strtoll(s.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0')
+            return false;
+        out = v;
+        return true;
+    }
+
+    bool readSpillValue(ifstream &in, string &value)
+    {
+        unsigned char head[4];
+        if (!in.read(reinterpret_cast<char *>(head), 4))
+            return false;
+        uint32_t len = head[0] | (head[1] << 8) | (head[2] << 16) | (static_cast<uint32_t>(head[3]) << 24);
+        value.resize(len);
+        return len == 0 || static_cast<bool>(in.read(&value[0], len));
+    }
+}
+
+CsvExportWriter::CsvExportWriter(const string &filePath, const vector<string> &header)
+    : buffer(kWriteBufferBytes)
+{
+    fout.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    fout.open(filePath, ios::binary | ios::trunc);
+    maxInFlight = max(2u, thread::hardware_concurrency()) * 2;
+    if (!fout.is_open())
+        return;
+    string head;
+    appendCsvRow(head, header);
+    fout.write(head.data(), head.size());
+    bytes += head.size();
+}
+
+bool CsvExportWriter::isOpen() const
+{
+    return fout.is_open();
+}
+
+// 小批先并入当前批次,攒够kBatchRows行再交给后台线程
+void CsvExportWriter::add(RowBatch &rows)
+{
+    if (batch.empty())
+        batch = move(rows);
+    else
+        batch.append(rows);
+    rows.clear();
+    if (batch.size() >= kBatchRows)
+        dispatch();
+}
+
+// 把当前批次交给后台线程格式化,在途批次过多时先写出最早的一批
+void CsvExportWriter::dispatch()
+{
+    if (batch.empty())
+        return;
+    auto rows = make_shared<RowBatch>(move(batch));
+    batch.clear();
+    pending.push_back(async(launch::async, [rows]()
+                            { return formatBatch(*rows); }));
+    while (pending.size() >= maxInFlight)
+        writeOldest();
+}
+
+void CsvExportWriter::writeOldest()
+{
+    string chunk = pending.front().get();
+    pending.pop_front();
+    fout.write(chunk.data(), chunk.size());
+    bytes += chunk.size();
+}
+
+bool CsvExportWriter::finish()
+{
+    if (!fout.is_open())
+        return false;
+    dispatch();
+    while (!pending.empty())
+        writeOldest();
+    fout.close();
+    return !fout.fail();
+}
+
+BinaryExportWriter::BinaryExportWriter(const string &filePath, const vector<pair<string, string>> &columnDefs)
+    : path(filePath), columns(columnDefs), spillBuffers(columnDefs.size()), dataBytes(columnDefs.size(), 0)
+{
+    for (size_t c = 0; c < columns.size() && ok; ++c)
+    {
+        string type = columns[c].second;
+        transform(type.begin(), type.end(), type.begin(), ::tolower);
+        intColumns.push_back(type == "int");
+        spillPaths.push_back(path + ".col" + to_string(c) + ".tmp");
+        spills.push_back(make_unique<ofstream>(spillPaths.back(), ios::binary | ios::trunc));
+        ok = spills.back()->is_open();
+    }
+}
+
+BinaryExportWriter::~BinaryExportWriter()
+{
+    for (size_t c = 0; c < spills.size(); ++c)
+    {
+        spills[c]->close();
+        fs::remove(spillPaths[c]);
+    }
+}
+
+bool BinaryExportWriter::isOpen() const
+{
+    return ok;
+}
+
+void BinaryExportWriter::add(const RowBatch &batch)
+{
+    if (!ok)
+        return;
+    for (size_t r = 0; r < batch.size(); ++r)
+    {
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            string_view value = batch.field(r, c);
+            long long parsed = 0;
+            if (intColumns[c] && !batch.intField(r, c, parsed))
+                intColumns[c] = false;
+            putFixed(spillBuffers[c], value.size(), 4);
+            spillBuffers[c] += value;
+            dataBytes[c] += value.size();
+            if (spillBuffers[c].size() >= kWriteBufferBytes)
+                flushSpill(c);
+        }
+        ++rows;
+    }
+}
+
+void BinaryExportWriter::flushSpill(size_t column)
+{
+    spills[column]->write(spillBuffers[column].data(), spillBuffers[column].size());
+    spillBuffers[column].clear();
+    ok = ok && static_cast<bool>(*spills[column]);
+}
+
+/*
+文件布局(小端,各区段8字节对齐):
+  0   "MDBCOL1\0"
+  8   uint32 版本(1)    12  uint32 列数    16  uint64 行数
+  24  列目录,每列48字节:
+        uint32 类型(0=int64, 1=string)  uint32 列名长度  uint64 列名偏移
+        uint64 值区偏移  uint64 值区字节数  uint64 字符串区偏移  uint64 字符串区字节数
+  int64列的值区是行数个int64;string列的值区是行数+1个uint64偏移,第i行为字符串区的[off[i], off[i+1])
+*/
+bool BinaryExportWriter::finish()
+{
+    for (size_t c = 0; c < columns.size() && ok; ++c)
+    {
+        flushSpill(c);
+        spills[c]->close();
+    }
+    if (!ok)
+        return false;
+
+    // 先计算各区段偏移,写出文件头、列目录和列名
+    uint64_t namesOffset = align8(24 + 48 * columns.size());
+    uint64_t cursor = namesOffset;
+    vector<uint64_t> nameOffsets;
+    for (const auto &column : columns)
+    {
+        nameOffsets.push_back(cursor);
+        cursor += column.first.size();
+    }
+    string head("MDBCOL1\0", 8);
+    putFixed(head, 1, 4);
+    putFixed(head, columns.size(), 4);
+    putFixed(head, rows, 8);
+    cursor = align8(cursor);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        uint64_t valuesBytes = intColumns[c] ? rows * 8 : (rows + 1) * 8;
+        uint64_t valuesOffset = cursor;
+        cursor = align8(cursor + valuesBytes);
+        uint64_t stringOffset = intColumns[c] ? 0 : cursor;
+        uint64_t stringBytes = intColumns[c] ? 0 : dataBytes[c];
+        cursor = align8(cursor + stringBytes);
+        putFixed(head, intColumns[c] ? 0 : 1, 4);
+        putFixed(head, columns[c].first.size(), 4);
+        putFixed(head, nameOffsets[c], 8);
+        putFixed(head, valuesOffset, 8);
+        putFixed(head, valuesBytes, 8);
+        putFixed(head, stringOffset, 8);
+        putFixed(head, stringBytes, 8);
+    }
+    head.resize(namesOffset, '\0');
+    for (const auto &column : columns)
+        head += column.first;
+    head.resize(align8(head.size()), '\0');
+
+    vector<char> fileBuffer(kWriteBufferBytes);
+    ofstream fout;
+    fout.rdbuf()->pubsetbuf(fileBuffer.data(), fileBuffer.size());
+    fout.open(path, ios::binary | ios::trunc);
+    if (!fout.is_open())
+        return false;
+    fout.write(head.data(), head.size());
+    bytes = head.size();
+
+    // 逐列从临时文件读回并写出,字符串列读两遍:先写偏移数组,再写字符串内容
+    string out, value;
+    auto drain = [&](bool force)
+    {
+        if (force || out.size() >= kWriteBufferBytes)
+        {
+            fout.write(out.data(), out.size());
+            bytes += out.size();
+            out.clear();
+        }
+    };
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        ifstream in(spillPaths[c], ios::binary);
+        if (intColumns[c])
+        {
+            while (readSpillValue(in, value))
+            {
+                int64_t v = 0;
+                parseInt(value, v);
+                putFixed(out, static_cast<uint64_t>(v), 8);
+                drain(false);
+            }
+        }
+        else
+        {
+            uint64_t offset = 0;
+            putFixed(out, 0, 8);
+            while (readSpillValue(in, value))
+            {
+                offset += value.size();
+                putFixed(out, offset, 8);
+                drain(false);
+            }
+            out.resize(align8(bytes + out.size()) - bytes, '\0');
+            in.clear();
+            in.seekg(0);
+            while (readSpillValue(in, value))
+            {
+                out += value;
+                drain(false);
+            }
+        }
+        out.resize(align8(bytes + out.size()) - bytes, '\0');
+        drain(true);
+    }
+    fout.close();
+    return !fout.fail();
+}
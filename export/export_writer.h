@@ -0,0 +1,63 @@
+//export_writer.h - 导出写入器头文件
+
+#pragma once
+#include "../common/row_batch.h"
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+
+// CSV导出写入器,记录按批交给后台线程格式化,再按提交顺序写出,内存占用只与在途批数有关
+class CsvExportWriter
+{
+public:
+    CsvExportWriter(const string &filePath, const vector<string> &header);
+    bool isOpen() const;
+    // 接收一批记录,批中的内容被取走
+    void add(RowBatch &rows);
+    // 写出剩余批次并关闭文件
+    bool finish();
+    uint64_t bytesWritten() const { return bytes; }
+
+private:
+    void dispatch();
+    void writeOldest();
+
+    vector<char> buffer; // ofstream的写缓冲区,需在文件打开前设置
+    ofstream fout;
+    RowBatch batch;
+    deque<future<string>> pending;
+    size_t maxInFlight;
+    uint64_t bytes = 0;
+};
+
+// 二进制列式导出写入器,输出文件可直接内存映射按列访问,无需解析
+// 写入时每列先落到临时文件,finish时按列拼接为最终文件
+class BinaryExportWriter
+{
+public:
+    BinaryExportWriter(const string &filePath, const vector<pair<string, string>> &columns);
+    ~BinaryExportWriter();
+    bool isOpen() const;
+    void add(const RowBatch &rows);
+    bool finish();
+    uint64_t bytesWritten() const { return bytes; }
+
+private:
+    void flushSpill(size_t column);
+
+    string path;
+    vector<pair<string, string>> columns;
+    vector<string> spillPaths;
+    vector<unique_ptr<ofstream>> spills;
+    vector<string> spillBuffers;
+    vector<bool> intColumns; // int类型且全部值都是整数的列按int64数组输出
+    vector<uint64_t> dataBytes;
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    bool ok = true;
+};
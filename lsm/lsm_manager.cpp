@@ -0,0 +1,889 @@
+//lsm_manager.cpp - LSM存储引擎实现
+
+#include "lsm_manager.h"
+#include "../catalog/catalog_manager.h"
+#include "../stats/stats_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+using namespace std;
+namespace fs = filesystem;
+
+namespace
+{
+    constexpr size_t kMemtableBytes = 4 << 20; // 内存表超过4MB后写成有序文件
+    constexpr size_t kTierRuns = 4;            // 同一层的有序文件数达到4个时合并到下一层
+    constexpr size_t kIndexInterval = 64;      // 有序文件中每64条记录建一个稀疏索引项
+    constexpr size_t kIoBuffer = 1 << 16;
+    constexpr size_t kEntryOverhead = 64; // 估算内存表占用时每条记录的额外开销
+
+    bool parseInt(const string &s, long long &out)
+    {
+        if (s.empty())
+            return false;
+        errno = 0;
+        char *end = nullptr;
+        out = strtoll(s.c_str(), &end, 10);
+        return errno == 0 && *end == '\0';
+    }
+
+    // 键的顺序:int键列按数值排序(数值相同时按原文),整数排在非整数之前;其余按字符串排序
+    struct KeyLess
+    {
+        bool numeric = false;
+        bool operator()(const string &a, const string &b) const
+        {
+            long long x = 0, y = 0;
+            bool ia = numeric && parseInt(a, x), ib = numeric && parseInt(b, y);
+            if (ia && ib && x != y)
+                return x < y;
+            if (ia != ib)
+                return ia;
+            return a < b;
+        }
+    };
+
+    // 一条记录的一个版本,deleted为true表示删除标记
+    struct Entry
+    {
+        string key;
+        bool deleted = false;
+        string row;
+    };
+
+    string trimmed(const string &s)
+    {
+        size_t begin = s.find_first_not_of(" \t\r\n");
+        if (begin == string::npos)
+            return "";
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    vector<string> splitRow(const string &line)
+    {
+        stringstream ss(line);
+        string field;
+        vector<string> row;
+        while (getline(ss, field, ','))
+            row.push_back(field);
+        return row;
+    }
+
+    string joinRow(const vector<string> &row)
+    {
+        string line;
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            line += row[i];
+            if (i != row.size() - 1)
+                line += ",";
+        }
+        return line;
+    }
+
+    void putFixed(string &out, uint64_t v, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+
+    bool readFixed(istream &in, uint64_t &v, int bytes)
+    {
+        unsigned char buf[8];
+        if (!in.read(reinterpret_cast<char *>(buf), bytes))
+            return false;
+        v = 0;
+        for (int i = 0; i < bytes; ++i)
+            v |= static_cast<uint64_t>(buf[i]) << (8 * i);
+        return true;
+    }
+
+    void encodeEntry(string &out, const Entry &e)
+    {
+        out.push_back(e.deleted ? 1 : 0);
+        putFixed(out, e.key.size(), 4);
+        out += e.key;
+        putFixed(out, e.row.size(), 4);
+        out += e.row;
+    }
+
+    // 读取一条记录,返回其占用的字节数,失败返回0
+    uint64_t decodeEntry(istream &in, Entry &e)
+    {
+        char flag = 0;
+        uint64_t keyLen = 0, rowLen = 0;
+        if (!in.get(flag) || !readFixed(in, keyLen, 4))
+            return 0;
+        e.key.resize(keyLen);
+        if (keyLen > 0 && !in.read(&e.key[0], keyLen))
+            return 0;
+        if (!readFixed(in, rowLen, 4))
+            return 0;
+        e.row.resize(rowLen);
+        if (rowLen > 0 && !in.read(&e.row[0], rowLen))
+            return 0;
+        e.deleted = flag != 0;
+        return 9 + keyLen + rowLen;
+    }
+
+    /*
+    有序文件格式(小端):
+      "MDBRUN1\n"
+      记录区:按键升序,每条为 uint8 删除标记 + uint32 键长 + 键 + uint32 行长 + 行文本
+      稀疏索引:每kIndexInterval条记录一项,uint32 键长 + 键 + uint64 记录偏移
+      尾部:uint64 索引偏移 + uint64 索引项数 + uint64 记录数
+    */
+    class SortedRun
+    {
+    public:
+        SortedRun(const string &path, uint64_t id, int tier) : path(path), id(id), tier(tier) {}
+
+        // 被合并掉的文件在最后一个读者释放后删除
+        ~SortedRun()
+        {
+            if (obsolete)
+                fs::remove(path);
+        }
+
+        bool load()
+        {
+            ifstream in(path, ios::binary);
+            in.seekg(0, ios::end);
+            streamoff size = in.tellg();
+            if (!in || size < 32)
+                return false;
+            in.seekg(size - 24);
+            uint64_t indexCount = 0;
+            if (!readFixed(in, dataEnd, 8) || !readFixed(in, indexCount, 8) || !readFixed(in, entries, 8))
+                return false;
+            in.seekg(dataEnd);
+            for (uint64_t i = 0; i < indexCount; ++i)
+            {
+                uint64_t keyLen = 0, offset = 0;
+                string key;
+                if (!readFixed(in, keyLen, 4))
+                    return false;
+                key.resize(keyLen);
+                if (keyLen > 0 && !in.read(&key[0], keyLen))
+                    return false;
+                if (!readFixed(in, offset, 8))
+                    return false;
+                index.emplace_back(move(key), offset);
+            }
+            bytes = static_cast<uint64_t>(size);
+            return true;
+        }
+
+        // 按键查找,稀疏索引定位到块后最多顺序读kIndexInterval条
+        bool get(const string &key, const KeyLess &less, Entry &out) const
+        {
+            auto it = upper_bound(index.begin(), index.end(), key, [&](const string &k, const pair<string, uint64_t> &item)
+                                  { return less(k, item.first); });
+            if (it == index.begin())
+                return false;
+            --it;
+            ifstream in(path, ios::binary);
+            in.seekg(it->second);
+            uint64_t pos = it->second;
+            bool found = false;
+            for (size_t i = 0; i < kIndexInterval && pos < dataEnd; ++i)
+            {
+                uint64_t used = decodeEntry(in, out);
+                if (used == 0 || less(key, out.key))
+                    break;
+                pos += used;
+                if (!less(out.key, key))
+                {
+                    found = true;
+                    break;
+                }
+            }
+            StatsManager::addBytesRead(pos - it->second);
+            return found;
+        }
+
+        string path;
+        uint64_t id;
+        int tier;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+        uint64_t dataEnd = 0;
+        vector<pair<string, uint64_t>> index;
+        atomic<bool> obsolete{false};
+    };
+
+    // 顺序写出有序文件,记录必须按键升序加入
+    class RunWriter
+    {
+    public:
+        RunWriter(const string &path) : buffer(kIoBuffer)
+        {
+            fout.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+            fout.open(path, ios::binary | ios::trunc);
+            out = "MDBRUN1\n";
+        }
+
+        void add(const Entry &e)
+        {
+            if (entries % kIndexInterval == 0)
+                index.emplace_back(e.key, offset + out.size());
+            encodeEntry(out, e);
+            ++entries;
+            if (out.size() >= kIoBuffer)
+                drain();
+        }
+
+        bool finish()
+        {
+            uint64_t indexOffset = offset + out.size();
+            for (const auto &[key, at] : index)
+            {
+                putFixed(out, key.size(), 4);
+                out += key;
+                putFixed(out, at, 8);
+            }
+            putFixed(out, indexOffset, 8);
+            putFixed(out, index.size(), 8);
+            putFixed(out, entries, 8);
+            drain();
+            fout.close();
+            StatsManager::addBytesWritten(offset);
+            return !fout.fail();
+        }
+
+    private:
+        void drain()
+        {
+            fout.write(out.data(), out.size());
+            offset += out.size();
+            out.clear();
+        }
+
+        vector<char> buffer;
+        ofstream fout;
+        string out;
+        uint64_t offset = 0;
+        uint64_t entries = 0;
+        vector<pair<string, uint64_t>> index;
+    };
+
+    // 合并的输入,按键升序产生记录
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+        virtual bool next(Entry &e) = 0;
+    };
+
+    class MemtableSource : public Source
+    {
+    public:
+        MemtableSource(const map<string, Entry, KeyLess> &memtable) : it(memtable.begin()), end(memtable.end()) {}
+
+        bool next(Entry &e) override
+        {
+            if (it == end)
+                return false;
+            e = it->second;
+            ++it;
+            return true;
+        }
+
+    private:
+        map<string, Entry, KeyLess>::const_iterator it, end;
+    };
+
+    class RunCursor : public Source
+    {
+    public:
+        RunCursor(const shared_ptr<SortedRun> &run) : run(run), buffer(kIoBuffer)
+        {
+            in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+            in.open(run->path, ios::binary);
+            in.seekg(pos);
+        }
+
+        ~RunCursor() { StatsManager::addBytesRead(pos); }
+
+        bool next(Entry &e) override
+        {
+            if (pos >= run->dataEnd)
+                return false;
+            uint64_t used = decodeEntry(in, e);
+            pos += used;
+            return used > 0;
+        }
+
+    private:
+        shared_ptr<SortedRun> run;
+        vector<char> buffer;
+        ifstream in;
+        uint64_t pos = 8;
+    };
+
+    // 多路合并,sources按从新到旧排列,同一个键只输出最新的版本
+    class MergeIterator
+    {
+    public:
+        MergeIterator(vector<unique_ptr<Source>> inputs, const KeyLess &less)
+            : sources(move(inputs)), heads(sources.size()), alive(sources.size()), less(less)
+        {
+            for (size_t i = 0; i < sources.size(); ++i)
+                alive[i] = sources[i]->next(heads[i]);
+        }
+
+        bool next(Entry &out)
+        {
+            // 输入的个数等于有序文件数,很少超过十几个,线性选择即可
+            int best = -1;
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                if (alive[i] && (best < 0 || less(heads[i].key, heads[best].key)))
+                    best = static_cast<int>(i);
+            }
+            if (best < 0)
+                return false;
+            out = move(heads[best]);
+            alive[best] = sources[best]->next(heads[best]);
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                while (alive[i] && !less(out.key, heads[i].key))
+                    alive[i] = sources[i]->next(heads[i]);
+            }
+            return true;
+        }
+
+    private:
+        vector<unique_ptr<Source>> sources;
+        vector<Entry> heads;
+        vector<char> alive;
+        KeyLess less;
+    };
+
+    struct LsmTable
+    {
+        string name;
+        KeyLess less;
+        map<string, Entry, KeyLess> memtable; // 只由主线程访问
+        size_t memBytes = 0;
+        ofstream wal;
+
+        mutex mu; // 保护以下成员,与后台合并线程共享
+        condition_variable idle;
+        vector<shared_ptr<SortedRun>> runs; // 从新到旧,层号不减
+        uint64_t nextId = 1;
+        bool compacting = false;
+    };
+
+    // 已打开的表,只由主线程访问
+    map<string, unique_ptr<LsmTable>> tables;
+
+    // 后台合并线程及其任务队列
+    mutex queueMutex;
+    condition_variable queueReady;
+    deque<LsmTable *> pending;
+    thread worker;
+    atomic<bool> stopping{false};
+
+    string walPath(const string &tableName)
+    {
+        return "data/" + tableName + ".wal";
+    }
+
+    string manifestPath(const string &tableName)
+    {
+        return "data/" + tableName + ".lsm";
+    }
+
+    string runPath(const string &tableName, uint64_t id)
+    {
+        return "data/" + tableName + ".r" + to_string(id) + ".run";
+    }
+
+    // 判断文件名是否为表的有序文件,是则取出编号
+    bool parseRunName(const string &file, const string &tableName, uint64_t &id)
+    {
+        string prefix = tableName + ".r", suffix = ".run";
+        if (file.size() <= prefix.size() + suffix.size() || file.compare(0, prefix.size(), prefix) != 0 ||
+            file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0)
+            return false;
+        string digits = file.substr(prefix.size(), file.size() - prefix.size() - suffix.size());
+        if (!all_of(digits.begin(), digits.end(), ::isdigit))
+            return false;
+        id = stoull(digits);
+        return true;
+    }
+
+    // 清单记录下一个文件编号和从新到旧的有序文件,先写临时文件再重命名;调用者持有mu
+    bool writeManifest(const LsmTable &t)
+    {
+        string path = manifestPath(t.name), tmp = path + ".tmp";
+        {
+            ofstream fout(tmp, ios::trunc);
+            fout << "next " << t.nextId << "\n";
+            for (const auto &run : t.runs)
+                fout << "run " << run->id << " " << run->tier << "\n";
+            if (!fout)
+                return false;
+        }
+        error_code ec;
+        fs::rename(tmp, path, ec);
+        return !ec;
+    }
+
+    void applyPut(LsmTable &t, const string &line)
+    {
+        string key = trimmed(line.substr(0, line.find(',')));
+        t.memBytes += key.size() + line.size() + kEntryOverhead;
+        t.memtable[key] = Entry{key, false, line};
+    }
+
+    void applyDelete(LsmTable &t, const string &key)
+    {
+        t.memBytes += key.size() + kEntryOverhead;
+        t.memtable[key] = Entry{key, true, ""};
+    }
+
+    void schedule(LsmTable &t);
+
+    // 打开表:读取清单,清除未登记的有序文件,重放预写日志恢复内存表
+    LsmTable &table(const string &tableName)
+    {
+        auto it = tables.find(tableName);
+        if (it != tables.end())
+            return *it->second;
+
+        auto t = make_unique<LsmTable>();
+        t->name = tableName;
+        auto columns = CatalogManager::getColumns(tableName);
+        t->less.numeric = !columns.empty() && columns[0].second == "int";
+        t->memtable = map<string, Entry, KeyLess>(t->less);
+        fs::create_directory("data");
+
+        set<uint64_t> live;
+        ifstream manifest(manifestPath(tableName));
+        string word;
+        while (manifest >> word)
+        {
+            if (word == "next")
+                manifest >> t->nextId;
+            else if (word == "run")
+            {
+                uint64_t id = 0;
+                int tier = 0;
+                manifest >> id >> tier;
+                auto run = make_shared<SortedRun>(runPath(tableName, id), id, tier);
+                if (run->load())
+                {
+                    t->runs.push_back(run);
+                    live.insert(id);
+                }
+            }
+        }
+
+        // 写出后未来得及登记或合并后未来得及删除的文件
+        for (const auto &entry : fs::directory_iterator("data"))
+        {
+            uint64_t id = 0;
+            if (parseRunName(entry.path().filename().string(), tableName, id) && !live.count(id))
+                fs::remove(entry.path());
+        }
+
+        ifstream wal(walPath(tableName));
+        string line;
+        while (getline(wal, line))
+        {
+            if (line.size() < 2)
+                continue;
+            if (line[0] == 'P')
+                applyPut(*t, line.substr(2));
+            else if (line[0] == 'D')
+                applyDelete(*t, line.substr(2));
+        }
+        t->wal.open(walPath(tableName), ios::app);
+        LsmTable &opened = *tables.emplace(tableName, move(t)).first->second;
+        // 上次退出前未合并完的层
+        schedule(opened);
+        return opened;
+    }
+
+    vector<shared_ptr<SortedRun>> snapshot(LsmTable &t)
+    {
+        lock_guard<mutex> lock(t.mu);
+        return t.runs;
+    }
+
+    // 找出从新到旧第一组文件数达到阈值的同层文件[first, last);调用者持有mu
+    bool pickGroup(const LsmTable &t, size_t &first, size_t &last)
+    {
+        for (size_t i = 0; i < t.runs.size();)
+        {
+            size_t j = i;
+            while (j < t.runs.size() && t.runs[j]->tier == t.runs[i]->tier)
+                ++j;
+            if (j - i >= kTierRuns)
+            {
+                first = i;
+                last = j;
+                return true;
+            }
+            i = j;
+        }
+        return false;
+    }
+
+    // 合并一组相邻的有序文件;包含最旧的文件时更旧的版本已不存在,删除标记可以丢弃
+    shared_ptr<SortedRun> mergeRuns(const LsmTable &t, const vector<shared_ptr<SortedRun>> &group, bool bottom,
+                                    uint64_t id, int tier)
+    {
+        vector<unique_ptr<Source>> sources;
+        for (const auto &run : group)
+            sources.push_back(make_unique<RunCursor>(run));
+        MergeIterator merged(move(sources), t.less);
+        string path = runPath(t.name, id);
+        RunWriter writer(path);
+        Entry e;
+        while (merged.next(e))
+        {
+            if (!(e.deleted && bottom))
+                writer.add(e);
+        }
+        auto run = make_shared<SortedRun>(path, id, tier);
+        if (!writer.finish() || !run->load())
+        {
+            fs::remove(path);
+            return nullptr;
+        }
+        return run;
+    }
+
+    // 用合并结果替换原来的一组文件并更新清单;调用者持有mu
+    void replaceRuns(LsmTable &t, const vector<shared_ptr<SortedRun>> &group, const shared_ptr<SortedRun> &merged)
+    {
+        auto first = find(t.runs.begin(), t.runs.end(), group.front());
+        auto pos = t.runs.erase(first, first + group.size());
+        if (merged->entries > 0)
+            t.runs.insert(pos, merged);
+        else
+            merged->obsolete = true;
+        writeManifest(t);
+        for (const auto &run : group)
+            run->obsolete = true;
+    }
+
+    // 反复合并达到阈值的层,直到没有可合并的文件
+    void compactTiers(LsmTable &t)
+    {
+        while (true)
+        {
+            vector<shared_ptr<SortedRun>> group;
+            bool bottom = false;
+            uint64_t id = 0;
+            int tier = 0;
+            {
+                lock_guard<mutex> lock(t.mu);
+                size_t first = 0, last = 0;
+                if (stopping || !pickGroup(t, first, last))
+                {
+                    t.compacting = false;
+                    t.idle.notify_all();
+                    return;
+                }
+                group.assign(t.runs.begin() + first, t.runs.begin() + last);
+                bottom = last == t.runs.size();
+                id = t.nextId++;
+                tier = group.front()->tier + 1;
+            }
+            auto merged = mergeRuns(t, group, bottom, id, tier);
+            lock_guard<mutex> lock(t.mu);
+            if (!merged)
+            {
+                t.compacting = false;
+                t.idle.notify_all();
+                return;
+            }
+            replaceRuns(t, group, merged);
+        }
+    }
+
+    void compactionLoop()
+    {
+        while (true)
+        {
+            LsmTable *t = nullptr;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueReady.wait(lock, []
+                                { return stopping || !pending.empty(); });
+                if (stopping)
+                    return;
+                t = pending.front();
+                pending.pop_front();
+            }
+            compactTiers(*t);
+        }
+    }
+
+    // 有可合并的层时交给后台线程
+    void schedule(LsmTable &t)
+    {
+        if (stopping)
+            return;
+        {
+            lock_guard<mutex> lock(t.mu);
+            size_t first = 0, last = 0;
+            if (t.compacting || !pickGroup(t, first, last))
+                return;
+            t.compacting = true;
+        }
+        lock_guard<mutex> lock(queueMutex);
+        if (!worker.joinable())
+            worker = thread(compactionLoop);
+        pending.push_back(&t);
+        queueReady.notify_one();
+    }
+
+    // 把内存表写成新的有序文件,登记到清单后清空预写日志
+    bool flushMemtable(LsmTable &t)
+    {
+        if (t.memtable.empty())
+            return true;
+        t.wal.flush();
+        uint64_t id = 0;
+        {
+            lock_guard<mutex> lock(t.mu);
+            id = t.nextId++;
+        }
+        string path = runPath(t.name, id);
+        RunWriter writer(path);
+        for (const auto &[key, entry] : t.memtable)
+            writer.add(entry);
+        auto run = make_shared<SortedRun>(path, id, 0);
+        if (!writer.finish() || !run->load())
+        {
+            fs::remove(path);
+            return false;
+        }
+        {
+            lock_guard<mutex> lock(t.mu);
+            t.runs.insert(t.runs.begin(), run);
+            if (!writeManifest(t))
+                return false;
+        }
+        t.memtable.clear();
+        t.memBytes = 0;
+        t.wal.close();
+        t.wal.open(walPath(t.name), ios::trunc);
+        schedule(t);
+        return true;
+    }
+
+    bool lookup(LsmTable &t, const string &key, Entry &e)
+    {
+        auto it = t.memtable.find(key);
+        if (it != t.memtable.end())
+        {
+            e = it->second;
+            return !e.deleted;
+        }
+        for (const auto &run : snapshot(t))
+        {
+            if (run->get(key, t.less, e))
+                return !e.deleted;
+        }
+        return false;
+    }
+}
+
+bool LsmManager::put(const string &tableName, const vector<string> &row)
+{
+    LsmTable &t = table(tableName);
+    string line = joinRow(row);
+    t.wal << "P " << line << "\n";
+    StatsManager::addBytesWritten(line.size() + 3);
+    applyPut(t, line);
+    if (t.memBytes >= kMemtableBytes && !flushMemtable(t))
+        return false;
+    return static_cast<bool>(t.wal);
+}
+
+bool LsmManager::remove(const string &tableName, const string &key)
+{
+    LsmTable &t = table(tableName);
+    t.wal << "D " << key << "\n";
+    StatsManager::addBytesWritten(key.size() + 3);
+    applyDelete(t, key);
+    if (t.memBytes >= kMemtableBytes && !flushMemtable(t))
+        return false;
+    return static_cast<bool>(t.wal);
+}
+
+bool LsmManager::sync(const string &tableName)
+{
+    LsmTable &t = table(tableName);
+    t.wal.flush();
+    return static_cast<bool>(t.wal);
+}
+
+bool LsmManager::get(const string &tableName, const string &key, vector<string> &row)
+{
+    Entry e;
+    if (!lookup(table(tableName), trimmed(key), e))
+        return false;
+    row = splitRow(e.row);
+    return true;
+}
+
+void LsmManager::scan(const string &tableName, int column, const string &value, const vector<int> &projection,
+                      const RowCallback &onRow)
+{
+    LsmTable &t = table(tableName);
+    string target = trimmed(value);
+    auto emit = [&](const string &line)
+    {
+        vector<string> row = splitRow(line);
+        if (column >= 0 && (row.size() <= static_cast<size_t>(column) || trimmed(row[column]) != target))
+            return;
+        if (projection.empty())
+        {
+            onRow(row);
+            return;
+        }
+        vector<string> out;
+        out.reserve(projection.size());
+        for (int c : projection)
+            out.push_back(static_cast<size_t>(c) < row.size() ? row[c] : "");
+        onRow(out);
+    };
+
+    // 键列上的等值条件直接按键查找
+    if (column == 0)
+    {
+        Entry e;
+        if (lookup(t, target, e))
+            emit(e.row);
+        StatsManager::addRowsScanned(1);
+        return;
+    }
+
+    vector<unique_ptr<Source>> sources;
+    sources.push_back(make_unique<MemtableSource>(t.memtable));
+    for (const auto &run : snapshot(t))
+        sources.push_back(make_unique<RunCursor>(run));
+    MergeIterator merged(move(sources), t.less);
+    Entry e;
+    uint64_t scanned = 0, dead = 0;
+    while (merged.next(e))
+    {
+        if (e.deleted)
+        {
+            ++dead;
+            continue;
+        }
+        ++scanned;
+        emit(e.row);
+    }
+    StatsManager::addRowsScanned(scanned);
+    StatsManager::addDeadRows(dead);
+}
+
+int LsmManager::compact(const string &tableName)
+{
+    LsmTable &t = table(tableName);
+    if (!flushMemtable(t))
+        return -1;
+    vector<shared_ptr<SortedRun>> group;
+    uint64_t id = 0;
+    {
+        // 等待后台合并结束,再把全部文件合并为一个
+        unique_lock<mutex> lock(t.mu);
+        t.idle.wait(lock, [&]
+                    { return !t.compacting; });
+        if (t.runs.empty())
+            return 0;
+        t.compacting = true;
+        group = t.runs;
+        id = t.nextId++;
+    }
+    auto merged = mergeRuns(t, group, true, id, group.back()->tier + 1);
+    lock_guard<mutex> lock(t.mu);
+    t.compacting = false;
+    t.idle.notify_all();
+    if (!merged)
+        return -1;
+    replaceRuns(t, group, merged);
+    return static_cast<int>(merged->entries);
+}
+
+size_t LsmManager::runCount(const string &tableName)
+{
+    return snapshot(table(tableName)).size();
+}
+
+void LsmManager::dropTable(const string &tableName)
+{
+    auto it = tables.find(tableName);
+    if (it != tables.end())
+    {
+        LsmTable &t = *it->second;
+        bool queued = false;
+        {
+            lock_guard<mutex> lock(queueMutex);
+            auto q = find(pending.begin(), pending.end(), &t);
+            if (q != pending.end())
+            {
+                pending.erase(q);
+                queued = true;
+            }
+        }
+        unique_lock<mutex> lock(t.mu);
+        if (queued)
+            t.compacting = false;
+        t.idle.wait(lock, [&]
+                    { return !t.compacting; });
+        for (const auto &run : t.runs)
+            run->obsolete = true;
+        t.runs.clear();
+        lock.unlock();
+        t.wal.close();
+        tables.erase(it);
+    }
+
+    fs::remove(walPath(tableName));
+    fs::remove(manifestPath(tableName));
+    error_code ec;
+    for (const auto &entry : fs::directory_iterator("data", ec))
+    {
+        uint64_t id = 0;
+        if (parseRunName(entry.path().filename().string(), tableName, id))
+            fs::remove(entry.path());
+    }
+}
+
+void LsmManager::shutdown()
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    if (worker.joinable())
+        worker.join();
+    for (auto &[name, t] : tables)
+    {
+        flushMemtable(*t);
+        t->wal.close();
+    }
+}
@@ -0,0 +1,37 @@
+//lsm_manager.h - LSM存储引擎头文件
+
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+using namespace std;
+
+// LSM存储引擎,用于CREATE TABLE ... WITH (storage = lsm)的表,以第一列为键
+// 写入先追加到预写日志data/<table>.wal,再进入内存有序表;内存表写满后整体写成不可变的有序文件
+// data/<table>.r<id>.run。更新和删除只写入新版本或删除标记,磁盘上只有顺序写
+// 有序文件按层(tier)组织,同一层的文件数达到阈值后由后台线程合并到下一层;读取时从新到旧合并内存表和各有序文件
+class LsmManager
+{
+public:
+    using RowCallback = function<void(vector<string> &row)>;
+
+    // 写入一行,键已存在时覆盖旧版本
+    static bool put(const string &tableName, const vector<string> &row);
+    // 写入删除标记
+    static bool remove(const string &tableName, const string &key);
+    // 一条语句写完后把预写日志刷到磁盘
+    static bool sync(const string &tableName);
+    // 按键查找,不存在或已删除时返回false
+    static bool get(const string &tableName, const string &key, vector<string> &row);
+    // 合并读取全部有效记录,column>=0时只输出该列等于value的记录(column为0时按键查找);projection非空时只输出这些列
+    static void scan(const string &tableName, int column, const string &value, const vector<int> &projection,
+                     const RowCallback &onRow);
+    // 把内存表和全部有序文件合并为一个并清除删除标记,返回有效记录数,失败返回-1
+    static int compact(const string &tableName);
+    // 当前的有序文件数
+    static size_t runCount(const string &tableName);
+    // 删除表的预写日志、清单和全部有序文件
+    static void dropTable(const string &tableName);
+    // 停止后台合并线程并把各表的内存表写成有序文件,程序退出时调用
+    static void shutdown();
+};
@@ -2,6 +2,12 @@
 #include "parser/parser.h"
 #include "catalog/catalog_manager.h"
 #include "record/record_manager.h"
+#include "stats/stats_manager.h"
+#include "optimizer/optimizer_manager.h"
+#include "bloom/bloom_filter.h"
+#include "cache/cache_manager.h"
+#include "lsm/lsm_manager.h"
+#include "view/view_manager.h"
 
 /*以下这些为通过自己平时知识储备得得知的头文件*/
 #include <vector>
@@ -13,6 +19,9 @@
 /*以下为通过网络搜索和大模型推荐的头文件*/
 #include <algorithm>
 #include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
 // #include <sstream>
 // #include <filesystem>
 
@@ -30,6 +39,59 @@ static string trim(string s)
     return s;
 }
 
+// 根据表结构把列名解析为列下标，扫描时只拆分和返回这些列；返回第一个不存在的列名，全部存在时返回空
+static string resolveColumns(const string &tableName, const vector<string> &names, vector<int> &projection)
+{
+    auto schema = CatalogManager::getColumns(tableName);
+    for (const auto &name : names)
+    {
+        auto it = find_if(schema.begin(), schema.end(), [&](const pair<string, string> &c)
+                          { return c.first == name; });
+        if (it == schema.end())
+            return name;
+        projection.push_back(static_cast<int>(it - schema.begin()));
+    }
+    return "";
+}
+
+// 会改写数据的命令所作用的表，其他命令返回空
+static string modifiedTable(const Command *cmd)
+{
+    switch (cmd->type)
+    {
+    case CommandType::INSERT:
+        return static_cast<const InsertCommand *>(cmd)->tableName;
+    case CommandType::DELETE:
+        return static_cast<const DeleteCommand *>(cmd)->tableName;
+    case CommandType::UPDATE:
+        return static_cast<const UpdateCommand *>(cmd)->tableName;
+    case CommandType::COMPACT:
+        return static_cast<const CompactCommand *>(cmd)->tableName;
+    case CommandType::DROP_PARTITION:
+        return static_cast<const DropPartitionCommand *>(cmd)->tableName;
+    case CommandType::CREATE_BLOOM:
+        return static_cast<const CreateBloomCommand *>(cmd)->tableName;
+    default:
+        return "";
+    }
+}
+
+// 输出查询结果，每个字段后跟一个制表符，整批结果拼好后一次写出
+static void printRows(const RowBatch &rows)
+{
+    string out;
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+        for (size_t c = 0; c < rows.fieldCount(r); ++c)
+        {
+            out += rows.field(r, c);
+            out += '\t';
+        }
+        out += '\n';
+    }
+    cout << out;
+}
+
 // 去除首尾空格和末尾分号
 static string clean(string s)
 {
@@ -49,6 +111,26 @@ int main()
     cout << "hello, welcome to MiniDB by YGX\n";
     cout << "Type 'exit' to quit\n\n";
 
+    // 启动时一次读入目录，目录文件损坏时不继续运行，以免覆盖
+    if (!CatalogManager::load())
+    {
+        cout << "Failed to load catalog 'metadata/catalog.bin' and its previous version: checksum mismatch or truncated file.\n";
+        return 1;
+    }
+    if (CatalogManager::recoveredFromPrevious())
+        cout << "Warning: 'metadata/catalog.bin' is corrupt, loaded the previous version; the last schema change may be lost.\n";
+
+    // 若设置了MINIDB_STATS_FILE,则按MINIDB_STATS_INTERVAL(秒,默认10)定期导出Prometheus格式指标
+    if (const char *statsFile = getenv("MINIDB_STATS_FILE"))
+    {
+        const char *interval = getenv("MINIDB_STATS_INTERVAL");
+        StatsManager::startPeriodicDump(statsFile, interval ? static_cast<unsigned>(atoi(interval)) : 10);
+    }
+
+    // 若设置了MINIDB_CACHE_BYTES,则在该字节预算内缓存SELECT的结果
+    if (const char *cacheBytes = getenv("MINIDB_CACHE_BYTES"))
+        CacheManager::setBudget(strtoull(cacheBytes, nullptr, 10));
+
     // 主循环
     while (true)
     {
@@ -63,21 +145,55 @@ int main()
         if (sql.empty())
             continue;
 
+        // 记录命令开始时间，用于延迟统计
+        auto begin = chrono::steady_clock::now();
+        bool ok = true;
+
         // 解析SQL语句，生成命令对象
         auto cmd = Parser::parse(sql);
 
         // 根据命令类型执行相应的操作
-        if (cmd->type == CommandType::CREATE)
+        string target = modifiedTable(cmd.get());
+        if (!target.empty() && CatalogManager::getStorage(target) == "view")
+        {
+            // 物化视图只随基表的写入更新，不能直接修改
+            ok = false;
+            cout << "'" << target << "' is a materialized view and cannot be modified directly.\n";
+        }
+        else if (cmd->type == CommandType::CREATE)
         {
             // 处理CREATE TABLE命令
             auto create = static_cast<CreateCommand *>(cmd.get());
-            if (CatalogManager::createTable(create->tableName, create->columns))
+            PartitionSpec partition;
+            partition.method = create->partitionMethod;
+            partition.column = create->partitionColumn;
+            if (partition.method == "range")
+            {
+                // 未显式给出MAXVALUE时追加一个存放其余记录的分区
+                partition.bounds = create->partitionBounds;
+                if (partition.bounds.empty() || partition.bounds.back() != "MAXVALUE")
+                    partition.bounds.push_back("MAXVALUE");
+                for (size_t i = 0; i < partition.bounds.size(); ++i)
+                    partition.ids.push_back(static_cast<int>(i));
+            }
+            else if (partition.method == "hash")
+            {
+                for (int i = 0; i < create->partitionCount; ++i)
+                    partition.ids.push_back(i);
+            }
+            else if (!partition.method.empty())
+            {
+                // 不支持的分区方式，交给createTable报错
+                partition.ids.clear();
+            }
+            if (CatalogManager::createTable(create->tableName, create->columns, partition, create->storage))
             {
                 cout << "Table '" << create->tableName << "' created successfully with "
                      << create->columns.size() << " columns.\n";
             }
             else
             {
+                ok = false;
                 cout << "Failed to create table '" << create->tableName << "'. "
                      << "Please check if the table already exists or you have write permissions.\n";
             }
@@ -86,13 +202,51 @@ int main()
         {
             // 处理INSERT命令
             auto insert = static_cast<InsertCommand *>(cmd.get());
-            if (RecordManager::insertRecord(insert->tableName, insert->values))
+            if (insert->source)
             {
-                cout << "Successfully inserted " << insert->values.size()
+                // INSERT INTO ... SELECT：边扫描源表边追加到目标表
+                auto select = insert->source.get();
+                vector<int> projection;
+                string unknownColumn = resolveColumns(select->tableName, select->columns, projection);
+                string col, val;
+                if (!select->condition.empty())
+                {
+                    size_t eq = select->condition.find('=');
+                    col = trim(select->condition.substr(0, eq));
+                    val = trim(select->condition.substr(eq + 1));
+                }
+                int count = unknownColumn.empty()
+                                ? RecordManager::insertSelect(insert->tableName, select->tableName, projection, col, val)
+                                : -1;
+                if (!unknownColumn.empty())
+                {
+                    ok = false;
+                    cout << "Unknown column '" << unknownColumn << "' in table '" << select->tableName << "'.\n";
+                }
+                else if (count >= 0)
+                {
+                    cout << "Successfully inserted " << count << " record(s) into table '" << insert->tableName << "'.\n";
+                }
+                else
+                {
+                    ok = false;
+                    cout << "Failed to insert data into table '" << insert->tableName << "'. "
+                         << "Please check if both tables exist and the data format is correct.\n";
+                }
+            }
+            else if (insert->rows.size() == 1 && RecordManager::insertRecord(insert->tableName, insert->rows[0]))
+            {
+                cout << "Successfully inserted " << insert->rows[0].size()
                      << " values into table '" << insert->tableName << "'.\n";
             }
+            else if (insert->rows.size() > 1 && RecordManager::insertRecords(insert->tableName, insert->rows) >= 0)
+            {
+                cout << "Successfully inserted " << insert->rows.size()
+                     << " record(s) into table '" << insert->tableName << "'.\n";
+            }
             else
             {
+                ok = false;
                 cout << "Failed to insert data into table '" << insert->tableName << "'. "
                      << "Please check if the table exists and the data format is correct.\n";
             }
@@ -101,10 +255,66 @@ int main()
         {
             // 处理SELECT命令
             auto select = static_cast<SelectCommand *>(cmd.get());
-            if (select->condition.empty())
+
+            // 开启结果缓存时，表未被写入过的相同语句直接返回上次的结果
+            string cacheKey = CacheManager::enabled() ? CacheManager::statementKey(*select) : "";
+            auto cached = [&](const function<RowBatch()> &run)
+            {
+                RowBatch rows;
+                if (!CacheManager::lookup(cacheKey, select->tableName, rows))
+                {
+                    rows = run();
+                    CacheManager::store(cacheKey, select->tableName, rows);
+                }
+                return rows;
+            };
+
+            vector<int> projection;
+            string unknownColumn;
+            bool aggregate = !select->groupBy.empty() || GroupAggregator::isAggregate(select->columns);
+            if (!aggregate)
+                unknownColumn = resolveColumns(select->tableName, select->columns, projection);
+            if (aggregate)
+            {
+                // 聚合查询：扫描一遍表按分组计算
+                string col, val;
+                if (!select->condition.empty())
+                {
+                    size_t eq = select->condition.find('=');
+                    col = trim(select->condition.substr(0, eq));
+                    val = trim(select->condition.substr(eq + 1));
+                }
+                RowBatch result;
+                bool done = CacheManager::lookup(cacheKey, select->tableName, result);
+                if (!done && ViewManager::aggregate(select->tableName, select->columns, select->groupBy, col, val, result))
+                {
+                    CacheManager::store(cacheKey, select->tableName, result);
+                    done = true;
+                }
+                if (done)
+                {
+                    cout << "Found " << result.size() << " group(s) in table '" << select->tableName << "':\n";
+                    cout << "----------------------------------------\n";
+                    printRows(result);
+                    cout << "----------------------------------------\n";
+                }
+                else
+                {
+                    ok = false;
+                    cout << "Failed to run aggregate query on table '" << select->tableName << "'. "
+                         << "Selected columns must appear in GROUP BY; COUNT, SUM and AVG (int columns) are supported.\n";
+                }
+            }
+            else if (!unknownColumn.empty())
+            {
+                ok = false;
+                cout << "Unknown column '" << unknownColumn << "' in table '" << select->tableName << "'.\n";
+            }
+            else if (select->condition.empty())
             {
                 // 无条件查询：返回所有记录
-                auto result = RecordManager::selectAll(select->tableName);
+                auto result = cached([&]
+                                     { return RecordManager::selectAll(select->tableName, projection); });
                 if (result.empty())
                 {
                     cout << "No records found in table '" << select->tableName << "'.\n";
@@ -113,12 +323,7 @@ int main()
                 {
                     cout << "Found " << result.size() << " record(s) in table '" << select->tableName << "':\n";
                     cout << "----------------------------------------\n";
-                    for (const auto &row : result)
-                    {
-                        for (const auto &f : row)
-                            cout << f << "\t";
-                        cout << "\n";
-                    }
+                    printRows(result);
                     cout << "----------------------------------------\n";
                 }
             }
@@ -128,7 +333,8 @@ int main()
                 size_t eq = select->condition.find('=');
                 string col = trim(select->condition.substr(0, eq));
                 string val = trim(select->condition.substr(eq + 1));
-                auto result = RecordManager::selectWhere(select->tableName, col, val);
+                auto result = cached([&]
+                                     { return RecordManager::selectWhere(select->tableName, col, val, projection); });
                 if (result.empty())
                 {
                     cout << "No records found in table '" << select->tableName
@@ -139,12 +345,7 @@ int main()
                     cout << "Found " << result.size() << " record(s) in table '" << select->tableName
                          << "' where " << col << " = " << val << ":\n";
                     cout << "----------------------------------------\n";
-                    for (const auto &row : result)
-                    {
-                        for (const auto &f : row)
-                            cout << f << "\t";
-                        cout << "\n";
-                    }
+                    printRows(result);
                     cout << "----------------------------------------\n";
                 }
             }
@@ -191,42 +392,207 @@ int main()
         {
             // 处理DROP TABLE命令
             auto drop = static_cast<DropCommand *>(cmd.get());
-            if (CatalogManager::dropTable(drop->tableName))
+            vector<string> views = CatalogManager::getViews(drop->tableName);
+            if (!views.empty())
             {
-                cout << "Table '" << drop->tableName << "' dropped successfully.\n";
+                // 仍有物化视图依赖该表时不能删除
+                ok = false;
+                cout << "Cannot drop table '" << drop->tableName << "': materialized view '" << views[0]
+                     << "' depends on it. Drop the view first.\n";
             }
             else
             {
-                cout << "Failed to drop table '" << drop->tableName << "'. Please check if the table exists.\n";
+                // 先丢弃物化视图的状态，再从目录中删除；目录写回后再等待该表的后台合并结束并删除LSM文件
+                ViewManager::dropView(drop->tableName);
+                if (CatalogManager::dropTable(drop->tableName))
+                {
+                    LsmManager::dropTable(drop->tableName);
+                    OptimizerManager::dropStats(drop->tableName);
+                    cout << "Table '" << drop->tableName << "' dropped successfully.\n";
+                }
+                else
+                {
+                    ok = false;
+                    cout << "Failed to drop table '" << drop->tableName << "'. Please check if the table exists.\n";
+                }
             }
         }
         else if (cmd->type == CommandType::EXPORT)
         {
             // 处理EXPORT TABLE命令
             auto exportCmd = static_cast<ExportTableCommand *>(cmd.get());
-            if (RecordManager::exportToCSV(exportCmd->tableName, exportCmd->filePath))
+            bool exported = exportCmd->format == "binary"
+                                ? RecordManager::exportToBinary(exportCmd->tableName, exportCmd->filePath)
+                                : RecordManager::exportToCSV(exportCmd->tableName, exportCmd->filePath);
+            if (exported)
             {
                 cout << "Table '" << exportCmd->tableName << "' exported to '" << exportCmd->filePath << "' successfully.\n";
             }
             else
             {
+                ok = false;
                 cout << "Failed to export table '" << exportCmd->tableName << "' to '" << exportCmd->filePath << "'. Please check if the table exists and the path is correct.\n";
             }
         }
+        else if (cmd->type == CommandType::DROP_PARTITION)
+        {
+            // 处理ALTER TABLE ... DROP PARTITION命令
+            auto dropPart = static_cast<DropPartitionCommand *>(cmd.get());
+            if (RecordManager::dropPartition(dropPart->tableName, dropPart->partitionId))
+            {
+                cout << "Partition p" << dropPart->partitionId << " of table '" << dropPart->tableName << "' dropped successfully.\n";
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to drop partition of table '" << dropPart->tableName
+                     << "'. Only existing RANGE partitions (p0, p1, ...) can be dropped.\n";
+            }
+        }
+        else if (cmd->type == CommandType::COMPACT)
+        {
+            // 处理COMPACT TABLE命令
+            auto compact = static_cast<CompactCommand *>(cmd.get());
+            int count = RecordManager::compactTable(compact->tableName);
+            if (count >= 0)
+            {
+                bool lsm = CatalogManager::getStorage(compact->tableName) == "lsm";
+                cout << "Table '" << compact->tableName << "' compacted: " << count
+                     << (lsm ? " record(s) merged into one sorted run.\n" : " record(s) stored in compressed segment.\n");
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to compact table '" << compact->tableName << "'. Please check if the table exists.\n";
+            }
+        }
+        else if (cmd->type == CommandType::CREATE_BLOOM)
+        {
+            // 处理CREATE BLOOM FILTER命令
+            auto bloom = static_cast<CreateBloomCommand *>(cmd.get());
+            if (RecordManager::createBloomFilter(bloom->tableName, bloom->column))
+            {
+                cout << "Bloom filter created on '" << bloom->tableName << "(" << bloom->column << ")'.\n";
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to create Bloom filter on '" << bloom->tableName << "(" << bloom->column << ")'. "
+                     << "Please check if the table and column exist.\n";
+            }
+        }
+        else if (cmd->type == CommandType::ANALYZE)
+        {
+            // 处理ANALYZE命令
+            auto analyze = static_cast<AnalyzeCommand *>(cmd.get());
+            int count = RecordManager::analyzeTable(analyze->tableName);
+            if (count >= 0)
+            {
+                cout << "Table '" << analyze->tableName << "' analyzed, " << count << " record(s) sampled.\n";
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to analyze table '" << analyze->tableName << "'. Please check if the table exists.\n";
+            }
+        }
+        else if (cmd->type == CommandType::EXPLAIN)
+        {
+            // 处理EXPLAIN命令，只生成计划不执行查询
+            auto select = static_cast<ExplainCommand *>(cmd.get())->query.get();
+            string col, val;
+            if (!select->condition.empty())
+            {
+                size_t eq = select->condition.find('=');
+                col = trim(select->condition.substr(0, eq));
+                val = trim(select->condition.substr(eq + 1));
+            }
+            ScanPlan plan;
+            if (RecordManager::planSelect(select->tableName, col, val, plan))
+            {
+                cout << OptimizerManager::explain(select->tableName, plan);
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to explain query on table '" << select->tableName
+                     << "'. Please check if the table and column exist.\n";
+            }
+        }
+        else if (cmd->type == CommandType::CREATE_VIEW)
+        {
+            // 处理CREATE MATERIALIZED VIEW命令：扫描一次基表得到初始结果，之后随基表的写入增量更新
+            auto create = static_cast<CreateViewCommand *>(cmd.get());
+            if (ViewManager::createView(create->viewName, create->query))
+            {
+                cout << "Materialized view '" << create->viewName << "' created successfully.\n";
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to create materialized view '" << create->viewName << "'. "
+                     << "Please check that the name is unused, the source table exists, selected columns appear in GROUP BY "
+                     << "and only COUNT, SUM and AVG (int columns) are used.\n";
+            }
+        }
+        else if (cmd->type == CommandType::REFRESH_VIEW)
+        {
+            // 处理REFRESH MATERIALIZED VIEW命令：扫描基表重新计算
+            auto refresh = static_cast<RefreshViewCommand *>(cmd.get());
+            if (ViewManager::refreshView(refresh->viewName))
+            {
+                cout << "Materialized view '" << refresh->viewName << "' refreshed.\n";
+            }
+            else
+            {
+                ok = false;
+                cout << "Failed to refresh materialized view '" << refresh->viewName << "'. Please check if the view exists.\n";
+            }
+        }
+        else if (cmd->type == CommandType::SHOW_STATS)
+        {
+            // 处理SHOW STATS命令
+            cout << StatsManager::report();
+            if (CacheManager::enabled())
+            {
+                cout << "Result cache:    " << CacheManager::entryCount() << " result(s), "
+                     << CacheManager::usedBytes() << " byte(s) in use\n";
+            }
+        }
         else
         {
             // 未知命令类型，该部分由大模型生成
+            ok = false;
             cout << "Unrecognized SQL command. Supported commands:\n";
-            cout << "  - CREATE TABLE <table_name> (<column_definitions>)\n";
+            cout << "  - CREATE TABLE <table_name> (<column_definitions>) [PARTITION BY RANGE(<column>) (<bounds>) | HASH(<column>) PARTITIONS <n>] [WITH (storage = lsm)]\n";
             cout << "  - DROP TABLE <table_name>\n";
-            cout << "  - INSERT INTO <table_name> VALUES (<values>)\n";
-            cout << "  - SELECT * FROM <table_name> [WHERE <condition>]\n";
+            cout << "  - INSERT INTO <table_name> VALUES (<values>)[, (<values>) ...]\n";
+            cout << "  - INSERT INTO <table_name> SELECT <* | column_list> FROM <table_name> [WHERE <condition>]\n";
+            cout << "  - SELECT <* | column_list> FROM <table_name> [WHERE <condition>] [GROUP BY <column_list>]\n";
             cout << "  - DELETE FROM <table_name> WHERE <condition>\n";
             cout << "  - UPDATE <table_name> SET <column> = <value> WHERE <condition>\n";
-            cout << "  - EXPORT TABLE <table_name> TO <file_path>\n";
+            cout << "  - EXPORT TABLE <table_name> TO '<file_path>' [FORMAT BINARY]\n";
+            cout << "  - ALTER TABLE <table_name> DROP PARTITION p<id>\n";
+            cout << "  - COMPACT TABLE <table_name>\n";
+            cout << "  - CREATE BLOOM FILTER ON <table_name>(<column>)\n";
+            cout << "  - CREATE MATERIALIZED VIEW <view_name> AS SELECT ... GROUP BY ...\n";
+            cout << "  - REFRESH MATERIALIZED VIEW <view_name>\n";
+            cout << "  - DROP MATERIALIZED VIEW <view_name>\n";
+            cout << "  - ANALYZE <table_name>\n";
+            cout << "  - EXPLAIN SELECT ...\n";
+            cout << "  - SHOW STATS\n";
         }
+
+        auto micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - begin).count();
+        StatsManager::recordCommand(cmd->type, static_cast<uint64_t>(micros), ok);
     }
 
+    StatsManager::stopPeriodicDump();
+    LsmManager::shutdown();
+    // 写回插入、删除时增量更新的统计信息和Bloom过滤器
+    OptimizerManager::flush();
+    BloomManager::flush();
+
     cout << "\nThank you for using MiniDB. Goodbye!\n";
     return 0;
 }
@@ -0,0 +1,547 @@
+//optimizer_manager.cpp - 统计信息与代价模型实现
+
+#include "optimizer_manager.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+using namespace std;
+namespace fs = filesystem;
+
+namespace
+{
+    constexpr int kSketchBits = 10; // HyperLogLog使用2^10个寄存器,标准误差约3%
+    constexpr size_t kSketchSize = size_t(1) << kSketchBits;
+    constexpr size_t kSampleRows = 30000; // 抽样行数
+    constexpr size_t kCommonValues = 10;  // 每列最多保存的最常见值个数
+    constexpr size_t kBuckets = 16;       // 直方图桶数
+
+    // 代价模型参数:代价单位为读取1字节文本
+    constexpr double kSegmentByteCost = 3.0;   // 压缩段每字节需要解码,比文本贵
+    constexpr double kRowCost = 20.0;          // 每个结果行的拆分与拷贝
+    constexpr double kWorkerCost = 1 << 20;    // 多启动一个扫描线程的代价
+    constexpr double kDefaultRowBytes = 48.0;  // 无统计信息时假定的平均行宽
+    constexpr double kDefaultSelectivity = 0.005; // 无统计信息时等值条件的选择率
+    constexpr double kBloomUselessRows = 3.0;     // 每个存储单元估计命中行数不少于此值时不探测Bloom过滤器
+
+    // 去掉首尾空格和字符串字面量外层的双引号,与查询时的比较方式一致
+    string normalize(const string &s)
+    {
+        size_t begin = s.find_first_not_of(" \t\r\n");
+        if (begin == string::npos)
+            return "";
+        size_t end = s.find_last_not_of(" \t\r\n");
+        string v = s.substr(begin, end - begin + 1);
+        if (v.size() >= 2 && v.front() == '"' && v.back() == '"')
+            v = v.substr(1, v.size() - 2);
+        return v;
+    }
+
+    bool isNull(const string &v)
+    {
+        if (v.empty())
+            return true;
+        string lower = v;
+        transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        return lower == "null";
+    }
+
+    bool parseInt(const string &s, long long &out)
+    {
+        if (s.empty())
+            return false;
+        errno = 0;
+        char *end = nullptr;
+        out = strtoll(s.c_str(), &end, 10);
+        return errno == 0 && *end == '\0';
+    }
+
+    // int列按数值比较,其余按字符串比较
+    bool lessValue(const string &a, const string &b, bool numeric)
+    {
+        long long x = 0, y = 0;
+        if (numeric && parseInt(a, x) && parseInt(b, y))
+            return x < y;
+        return a < b;
+    }
+
+    // FNV-1a后再做一次混合,保证高位分布均匀
+    uint64_t hashValue(const string &v)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : v)
+        {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void sketchAdd(vector<uint8_t> &sketch, const string &v)
+    {
+        if (sketch.size() != kSketchSize)
+            sketch.assign(kSketchSize, 0);
+        uint64_t h = hashValue(v);
+        size_t index = h >> (64 - kSketchBits);
+        uint64_t rest = h << kSketchBits;
+        uint8_t rank = rest == 0 ? 64 - kSketchBits + 1 : static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        sketch[index] = max(sketch[index], rank);
+    }
+
+    // 已加载的统计信息,nullptr表示该表没有统计信息
+    map<string, unique_ptr<TableStats>> cache;
+
+    string statsPath(const string &tableName)
+    {
+        return "metadata/" + tableName + ".stats";
+    }
+
+    /*
+    文件格式(每行一项):
+      Rows: <行数>
+      Modified: <修改行数>
+      Column: <列名> <类型>
+      Nulls: <空值数>
+      Sketch: <HyperLogLog寄存器,每个两位十六进制>
+      Common: <占比> <值>
+      Bound: <值>
+    Column之后的各项属于该列,值占据行的剩余部分
+    */
+    bool writeStats(const string &tableName, const TableStats &stats)
+    {
+        fs::create_directory("metadata");
+        string path = statsPath(tableName);
+        string tmp = path + ".tmp";
+        {
+            ofstream fout(tmp, ios::trunc);
+            if (!fout.is_open())
+                return false;
+            fout << setprecision(10);
+            fout << "Rows: " << stats.rows << "\n";
+            fout << "Modified: " << stats.modified << "\n";
+            for (const auto &column : stats.columns)
+            {
+                fout << "Column: " << column.name << " " << column.type << "\n";
+                fout << "Nulls: " << column.nulls << "\n";
+                fout << "Sketch: ";
+                for (uint8_t r : column.sketch)
+                    fout << "0123456789abcdef"[r >> 4] << "0123456789abcdef"[r & 15];
+                fout << "\n";
+                for (const auto &[value, fraction] : column.common)
+                    fout << "Common: " << fraction << " " << value << "\n";
+                for (const auto &bound : column.bounds)
+                    fout << "Bound: " << bound << "\n";
+            }
+            if (!fout)
+                return false;
+        }
+        error_code ec;
+        fs::rename(tmp, path, ec);
+        return !ec;
+    }
+
+    // 文件损坏(数值无法解析)时视为没有统计信息
+    unique_ptr<TableStats> readStats(const string &tableName)
+    {
+        ifstream fin(statsPath(tableName));
+        if (!fin.is_open())
+            return nullptr;
+        auto stats = make_unique<TableStats>();
+        string line;
+        try
+        {
+            while (getline(fin, line))
+            {
+                size_t colon = line.find(": ");
+                if (colon == string::npos)
+                    continue;
+                string key = line.substr(0, colon), value = line.substr(colon + 2);
+                if (key == "Rows")
+                    stats->rows = stoull(value);
+                else if (key == "Modified")
+                    stats->modified = stoull(value);
+                else if (key == "Column")
+                {
+                    stats->columns.emplace_back();
+                    stringstream ss(value);
+                    ss >> stats->columns.back().name >> stats->columns.back().type;
+                }
+                else if (stats->columns.empty())
+                    continue;
+                else if (key == "Nulls")
+                    stats->columns.back().nulls = stoull(value);
+                else if (key == "Sketch")
+                {
+                    auto &sketch = stats->columns.back().sketch;
+                    for (size_t i = 0; i + 1 < value.size(); i += 2)
+                        sketch.push_back(static_cast<uint8_t>(stoi(value.substr(i, 2), nullptr, 16)));
+                }
+                else if (key == "Common")
+                {
+                    size_t space = value.find(' ');
+                    stats->columns.back().common.emplace_back(value.substr(space + 1), stod(value.substr(0, space)));
+                }
+                else if (key == "Bound")
+                    stats->columns.back().bounds.push_back(value);
+            }
+        }
+        catch (const exception &)
+        {
+            return nullptr;
+        }
+        return stats;
+    }
+
+    uint64_t fileSize(const string &path)
+    {
+        error_code ec;
+        uint64_t size = fs::file_size(path, ec);
+        return ec ? 0 : size;
+    }
+}
+
+double ColumnStats::distinct() const
+{
+    if (sketch.size() != kSketchSize)
+        return 0;
+    double m = static_cast<double>(kSketchSize);
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t r : sketch)
+    {
+        sum += ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // 基数较小时用线性计数修正
+    if (estimate <= 2.5 * m && zeros > 0)
+        estimate = m * log(m / zeros);
+    return estimate;
+}
+
+void TableStats::addRow(const vector<string> &row)
+{
+    ++rows;
+    ++modified;
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        string v = c < row.size() ? normalize(row[c]) : "";
+        if (isNull(v))
+            ++columns[c].nulls;
+        else
+            sketchAdd(columns[c].sketch, v);
+    }
+    dirty = true;
+}
+
+void TableStats::removeRows(uint64_t n)
+{
+    rows -= min(rows, n);
+    modified += n;
+    dirty = true;
+}
+
+void TableStats::touchRows(uint64_t n)
+{
+    modified += n;
+    dirty = true;
+}
+
+StatsBuilder::StatsBuilder(const vector<pair<string, string>> &columns)
+{
+    for (const auto &[name, type] : columns)
+    {
+        ColumnStats column;
+        column.name = name;
+        column.type = type;
+        column.sketch.assign(kSketchSize, 0);
+        stats.columns.push_back(move(column));
+    }
+}
+
+void StatsBuilder::add(const vector<string> &row)
+{
+    vector<string> values(stats.columns.size());
+    for (size_t c = 0; c < values.size(); ++c)
+    {
+        values[c] = c < row.size() ? normalize(row[c]) : "";
+        if (isNull(values[c]))
+            ++stats.columns[c].nulls;
+        else
+            sketchAdd(stats.columns[c].sketch, values[c]);
+    }
+    ++stats.rows;
+
+    // 蓄水池抽样,每行以kSampleRows/seen的概率进入样本
+    ++seen;
+    if (sample.size() < kSampleRows)
+    {
+        sample.push_back(move(values));
+        return;
+    }
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    uint64_t slot = rng % seen;
+    if (slot < kSampleRows)
+        sample[slot] = move(values);
+}
+
+TableStats StatsBuilder::finish()
+{
+    for (size_t c = 0; c < stats.columns.size(); ++c)
+    {
+        ColumnStats &column = stats.columns[c];
+        bool numeric = column.type == "int";
+        vector<string> values;
+        for (auto &row : sample)
+        {
+            if (!isNull(row[c]))
+                values.push_back(move(row[c]));
+        }
+        if (values.empty())
+            continue;
+        auto less = [numeric](const string &a, const string &b)
+        { return lessValue(a, b, numeric); };
+        sort(values.begin(), values.end(), less);
+
+        // 统计样本中各值的出现次数,出现次数明显高于平均的值作为最常见值
+        vector<pair<size_t, size_t>> runs; // (起始下标, 次数)
+        for (size_t i = 0; i < values.size();)
+        {
+            size_t j = i;
+            while (j < values.size() && values[j] == values[i])
+                ++j;
+            runs.emplace_back(i, j - i);
+            i = j;
+        }
+        double average = static_cast<double>(values.size()) / runs.size();
+        vector<pair<size_t, size_t>> frequent;
+        for (const auto &run : runs)
+        {
+            if (run.second > 1 && run.second > average * 1.25)
+                frequent.push_back(run);
+        }
+        sort(frequent.begin(), frequent.end(), [](const pair<size_t, size_t> &a, const pair<size_t, size_t> &b)
+             { return a.second > b.second; });
+        if (frequent.size() > kCommonValues)
+            frequent.resize(kCommonValues);
+        vector<bool> isCommon(values.size(), false);
+        for (const auto &[start, count] : frequent)
+        {
+            column.common.emplace_back(values[start], static_cast<double>(count) / sample.size());
+            fill(isCommon.begin() + start, isCommon.begin() + start + count, true);
+        }
+
+        // 其余值构造等深直方图,每个桶包含数量大致相同的样本
+        vector<string> rest;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (!isCommon[i])
+                rest.push_back(values[i]);
+        }
+        for (size_t b = 0; b <= kBuckets && !rest.empty(); ++b)
+        {
+            const string &bound = rest[b * (rest.size() - 1) / kBuckets];
+            if (column.bounds.empty() || column.bounds.back() != bound)
+                column.bounds.push_back(bound);
+        }
+        // 首尾边界始终是样本的最小值和最大值
+        if (column.bounds.empty())
+            column.bounds.push_back(values.front());
+        column.bounds.front() = values.front();
+        if (column.bounds.size() == 1 && values.back() != values.front())
+            column.bounds.push_back(values.back());
+        column.bounds.back() = values.back();
+    }
+    sample.clear();
+    stats.dirty = false;
+    return stats;
+}
+
+TableStats *OptimizerManager::getStats(const string &tableName)
+{
+    auto it = cache.find(tableName);
+    if (it == cache.end())
+        it = cache.emplace(tableName, readStats(tableName)).first;
+    return it->second.get();
+}
+
+bool OptimizerManager::saveStats(const string &tableName, const TableStats &stats)
+{
+    cache[tableName] = make_unique<TableStats>(stats);
+    return writeStats(tableName, stats);
+}
+
+void OptimizerManager::dropStats(const string &tableName)
+{
+    cache.erase(tableName);
+    fs::remove(statsPath(tableName));
+}
+
+void OptimizerManager::flush()
+{
+    for (auto &[tableName, stats] : cache)
+    {
+        if (stats && stats->dirty && writeStats(tableName, *stats))
+            stats->dirty = false;
+    }
+}
+
+double OptimizerManager::estimateRows(const string &tableName, int column, const string &value)
+{
+    TableStats *stats = getStats(tableName);
+    if (!stats)
+        return -1;
+    double rows = static_cast<double>(stats->rows);
+    if (column < 0 || column >= static_cast<int>(stats->columns.size()) || rows == 0)
+        return column < 0 ? rows : rows * kDefaultSelectivity;
+
+    const ColumnStats &col = stats->columns[column];
+    bool numeric = col.type == "int";
+    string v = normalize(value);
+    if (isNull(v))
+        return static_cast<double>(col.nulls);
+
+    // 最常见值直接使用其占比
+    double commonFraction = 0;
+    for (const auto &[common, fraction] : col.common)
+    {
+        if (common == v)
+            return fraction * rows;
+        commonFraction += fraction;
+    }
+
+    // 其余值假定在除最常见值以外的不同值之间均匀分布
+    double restFraction = max(0.0, 1.0 - static_cast<double>(col.nulls) / rows - commonFraction);
+    double restDistinct = max(1.0, col.distinct() - col.common.size());
+    double estimate = rows * restFraction / restDistinct;
+
+    // 超出直方图范围的值只可能来自ANALYZE之后写入的记录
+    if (!col.bounds.empty() && (lessValue(v, col.bounds.front(), numeric) || lessValue(col.bounds.back(), v, numeric)))
+        estimate = min(estimate, static_cast<double>(stats->modified));
+    return estimate;
+}
+
+bool OptimizerManager::probeBloomFilters(const string &tableName, int column, const string &value, size_t units)
+{
+    // 没有统计信息时总是探测;估计每个存储单元都含有该值时,过滤器只会回答"可能存在",探测只是额外开销
+    double estimate = estimateRows(tableName, column, value);
+    return estimate < 0 || units == 0 || estimate / units < kBloomUselessRows;
+}
+
+ScanPlan OptimizerManager::planScan(const string &tableName, const vector<string> &units, size_t totalUnits,
+                                    int column, const string &value)
+{
+    ScanPlan plan;
+    plan.units = units;
+    plan.totalUnits = totalUnits;
+
+    // 每个存储单元的扫描代价由文本尾部和压缩段的大小决定
+    vector<double> unitCost;
+    double scanCost = 0, textBytes = 0;
+    for (const auto &base : units)
+    {
+        double text = static_cast<double>(fileSize(base + ".tbl"));
+        double segment = static_cast<double>(fileSize(base + ".seg"));
+        unitCost.push_back(text + segment * kSegmentByteCost);
+        scanCost += unitCost.back();
+        textBytes += text + segment;
+    }
+
+    double estimate = estimateRows(tableName, column, value);
+    plan.analyzed = estimate >= 0;
+    if (plan.analyzed)
+    {
+        plan.tableRows = static_cast<double>(getStats(tableName)->rows);
+        plan.rows = estimate;
+    }
+    else
+    {
+        plan.tableRows = textBytes / kDefaultRowBytes;
+        plan.rows = column < 0 ? plan.tableRows : plan.tableRows * kDefaultSelectivity;
+    }
+    plan.cost = scanCost + plan.rows * kRowCost;
+
+    // 小表启动线程的开销超过并行收益,按总代价(含按统计信息估计的结果行数)决定线程数:
+    // 同样大小的表,选择性高的条件串行扫描,结果行多的条件才并行;大的存储单元先调度,减少倾斜时的等待
+    size_t maxWorkers = min<size_t>(units.size(), max(1u, thread::hardware_concurrency()));
+    plan.workers = min<size_t>(maxWorkers, max<size_t>(1, static_cast<size_t>(ceil(plan.cost / kWorkerCost))));
+    for (size_t i = 0; i < units.size(); ++i)
+        plan.order.push_back(i);
+    stable_sort(plan.order.begin(), plan.order.end(), [&](size_t a, size_t b)
+                { return unitCost[a] > unitCost[b]; });
+    return plan;
+}
+
+string OptimizerManager::explain(const string &tableName, const ScanPlan &plan)
+{
+    ostringstream out;
+    out << fixed << setprecision(0);
+    out << "Plan for table '" << tableName << "':\n";
+    size_t candidates = plan.units.size() + plan.skippedUnits;
+    out << "  Access path:    ";
+    if (plan.lsm)
+    {
+        if (plan.pointLookup)
+            out << "LSM key lookup, memtable then " << plan.totalUnits << " sorted run(s) newest first\n";
+        else
+            out << "LSM merge scan, memtable + " << plan.totalUnits << " sorted run(s)\n";
+        if (plan.analyzed)
+            out << "  Estimated rows: " << plan.rows << " of " << plan.tableRows << "\n";
+        out << "  Statistics:     ";
+        if (!plan.analyzed)
+            out << "none, run ANALYZE " << tableName << "\n";
+        else
+            out << "analyzed, " << getStats(tableName)->modified << " row(s) modified since\n";
+        return out.str();
+    }
+    if (candidates == 0)
+        out << "none, no partition can contain the value\n";
+    else if (plan.skippedUnits > 0)
+    {
+        // Bloom过滤器排除的存储单元不扫描,先经过分区裁剪时一并说明
+        out << "bloom filter pruning, " << plan.units.size() << " of " << candidates << " unit(s) scanned, "
+            << plan.skippedUnits << " skipped by bloom filter on " << plan.bloomColumn;
+        if (candidates < plan.totalUnits)
+            out << " (after partition pruning to " << candidates << " of " << plan.totalUnits << " partition(s))";
+        out << "\n";
+    }
+    else if (candidates < plan.totalUnits)
+        out << "partition pruning, " << candidates << " of " << plan.totalUnits << " partition(s)\n";
+    else if (plan.totalUnits > 1)
+        out << "full scan, " << plan.totalUnits << " partition(s)\n";
+    else
+        out << "full scan\n";
+    if (plan.bloomBypassed)
+        out << "  Bloom filters:  not probed, value estimated to occur in every unit\n";
+    if (plan.order.size() > 1)
+    {
+        out << "  Scan order:     ";
+        for (size_t i = 0; i < plan.order.size(); ++i)
+            out << (i ? ", " : "") << plan.units[plan.order[i]];
+        out << "\n";
+    }
+    out << "  Workers:        " << plan.workers << "\n";
+    out << "  Estimated rows: " << plan.rows << " of " << plan.tableRows << "\n";
+    out << "  Estimated cost: " << plan.cost << "\n";
+    out << "  Statistics:     ";
+    if (!plan.analyzed)
+        out << "none, run ANALYZE " << tableName << "\n";
+    else
+        out << "analyzed, " << getStats(tableName)->modified << " row(s) modified since\n";
+    return out.str();
+}
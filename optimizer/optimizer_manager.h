@@ -0,0 +1,91 @@
+//optimizer_manager.h - 统计信息与代价模型头文件
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+// 单列统计信息
+struct ColumnStats
+{
+    string name;
+    string type;
+    uint64_t nulls = 0;                    // 空值(空字段或NULL)个数
+    vector<uint8_t> sketch;                // HyperLogLog寄存器,插入时增量更新
+    vector<pair<string, double>> common;   // 最常见值及其占比
+    vector<string> bounds;                 // 等深直方图的桶边界(不含最常见值),首尾为最小值和最大值
+
+    // 估计的不同值个数
+    double distinct() const;
+};
+
+// 表统计信息,由ANALYZE生成,保存在metadata/<table>.stats
+struct TableStats
+{
+    uint64_t rows = 0;     // 当前行数,插入和删除时增量维护
+    uint64_t modified = 0; // 上次ANALYZE以来修改的行数,直方图和最常见值只在ANALYZE时刷新
+    vector<ColumnStats> columns;
+    bool dirty = false;
+
+    // 增量维护:插入一行时更新行数、空值数和HyperLogLog
+    void addRow(const vector<string> &row);
+    void removeRows(uint64_t n);
+    void touchRows(uint64_t n);
+};
+
+// 扫描计划,由代价模型根据统计信息和文件大小生成
+struct ScanPlan
+{
+    vector<string> units;    // 需要扫描的存储单元
+    size_t totalUnits = 0;   // 表的存储单元总数
+    size_t skippedUnits = 0; // 被Bloom过滤器排除的存储单元数
+    bool bloomBypassed = false; // 统计信息表明该值在每个存储单元中都出现,未探测Bloom过滤器
+    string bloomColumn;         // 探测过的Bloom过滤器所在的列
+    vector<size_t> order;    // 调度顺序,代价大的存储单元先扫描
+    size_t workers = 1;      // 并行扫描的线程数
+    double tableRows = 0;    // 估计的表行数
+    double rows = 0;         // 估计的结果行数
+    double cost = 0;         // 估计的代价
+    bool analyzed = false;   // 是否有统计信息
+    bool lsm = false;        // LSM表,totalUnits为有序文件数
+    bool pointLookup = false; // LSM表按键查找
+};
+
+// ANALYZE时逐行收集统计信息,全表统计行数、空值和HyperLogLog,最常见值和直方图基于蓄水池抽样
+class StatsBuilder
+{
+public:
+    StatsBuilder(const vector<pair<string, string>> &columns);
+    void add(const vector<string> &row);
+    TableStats finish();
+
+private:
+    TableStats stats;
+    vector<vector<string>> sample;
+    uint64_t seen = 0;
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+};
+
+class OptimizerManager
+{
+public:
+    // 读取表的统计信息,表未ANALYZE时返回nullptr;返回的对象可增量更新,由flush写回
+    static TableStats *getStats(const string &tableName);
+    // 保存ANALYZE的结果
+    static bool saveStats(const string &tableName, const TableStats &stats);
+    // 删除表时丢弃其统计信息
+    static void dropStats(const string &tableName);
+    // 把增量更新过的统计信息写回文件
+    static void flush();
+
+    // 估计column列等于value的行数,column<0表示全表
+    static double estimateRows(const string &tableName, int column, const string &value);
+    // 条件列上有Bloom过滤器时是否值得探测:统计信息估计每个存储单元都含有该值时返回false
+    static bool probeBloomFilters(const string &tableName, int column, const string &value, size_t units);
+    // 为扫描units生成计划,column<0表示无条件
+    static ScanPlan planScan(const string &tableName, const vector<string> &units, size_t totalUnits,
+                             int column, const string &value);
+    // 生成EXPLAIN的文本
+    static string explain(const string &tableName, const ScanPlan &plan);
+};
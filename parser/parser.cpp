@@ -6,6 +6,7 @@
 #include <cctype>
 #include <string>
 #include <memory>
+#include <cstdlib>
 using namespace std;
 
 // 清理字符串首尾空格和末尾分号的辅助函数
@@ -19,6 +20,67 @@ string clean(string s)
     return s;
 }
 
+// 从pos起查找作为独立单词出现的关键字:前面是空白或字符串开头,后面是空白或字符串结尾
+// 避免把from_date这样的列名或表名中的子串当作关键字
+static size_t findKeyword(const string &lower, const string &keyword, size_t pos)
+{
+    for (pos = lower.find(keyword, pos); pos != string::npos; pos = lower.find(keyword, pos + 1))
+    {
+        size_t after = pos + keyword.size();
+        bool before = pos == 0 || isspace(static_cast<unsigned char>(lower[pos - 1]));
+        if (before && (after == lower.size() || isspace(static_cast<unsigned char>(lower[after]))))
+            return pos;
+    }
+    return string::npos;
+}
+
+// 解析VALUES后的元组列表(a, b), (c, d), ...,双引号内的逗号和括号不作为分隔符
+static vector<vector<string>> parseTuples(const string &text)
+{
+    vector<vector<string>> tuples;
+    vector<string> current;
+    string value;
+    bool inTuple = false, inQuote = false;
+    for (char c : text)
+    {
+        if (inQuote)
+        {
+            value.push_back(c);
+            inQuote = c != '"';
+            continue;
+        }
+        if (!inTuple)
+        {
+            if (c == '(')
+                inTuple = true;
+            continue;
+        }
+        if (c == '"')
+        {
+            inQuote = true;
+            value.push_back(c);
+        }
+        else if (c == ',')
+        {
+            current.push_back(clean(value));
+            value.clear();
+        }
+        else if (c == ')')
+        {
+            current.push_back(clean(value));
+            value.clear();
+            tuples.push_back(move(current));
+            current.clear();
+            inTuple = false;
+        }
+        else
+        {
+            value.push_back(c);
+        }
+    }
+    return tuples;
+}
+
 // 解析SQL语句的主函数
 unique_ptr<Command> Parser::parse(const string &sql)
 {
@@ -50,6 +112,57 @@ unique_ptr<Command> Parser::parse(const string &sql)
             part >> colName >> colType;
             cmd->columns.emplace_back(colName, colType);
         }
+
+        // 解析存储选项：WITH (storage = lsm)
+        size_t withPos = lower.find(" with", endParen);
+        while (withPos != string::npos)
+        {
+            size_t next = lower.find_first_not_of(" \t", withPos + 5);
+            if (next != string::npos && lower[next] == '(')
+                break;
+            withPos = lower.find(" with", withPos + 5);
+        }
+        if (withPos != string::npos)
+        {
+            size_t optOpen = lower.find('(', withPos);
+            size_t optClose = lower.find(')', optOpen);
+            size_t eq = lower.find('=', optOpen);
+            if (optOpen != string::npos && optClose != string::npos && eq < optClose &&
+                clean(lower.substr(optOpen + 1, eq - optOpen - 1)) == "storage")
+                cmd->storage = clean(lower.substr(eq + 1, optClose - eq - 1));
+            else
+                cmd->storage = "?"; // 无法识别的选项,交给createTable报错
+        }
+
+        // 解析分区定义：PARTITION BY RANGE(col) (b1, b2, ...) 或 PARTITION BY HASH(col) [PARTITIONS n]
+        size_t byPos = lower.find("partition by", endParen);
+        if (byPos != string::npos)
+        {
+            size_t methodPos = byPos + 12;
+            size_t colOpen = sql.find('(', methodPos);
+            size_t colClose = sql.find(')', colOpen);
+            if (colOpen == string::npos || colClose == string::npos)
+                return cmd;
+            cmd->partitionMethod = clean(lower.substr(methodPos, colOpen - methodPos));
+            cmd->partitionColumn = clean(sql.substr(colOpen + 1, colClose - colOpen - 1));
+            if (cmd->partitionMethod == "range")
+            {
+                size_t boundOpen = sql.find('(', colClose);
+                size_t boundClose = sql.find(')', boundOpen);
+                if (boundOpen != string::npos && boundClose != string::npos)
+                {
+                    stringstream bounds(sql.substr(boundOpen + 1, boundClose - boundOpen - 1));
+                    string bound;
+                    while (getline(bounds, bound, ','))
+                        cmd->partitionBounds.push_back(clean(bound));
+                }
+            }
+            else
+            {
+                size_t countPos = lower.find("partitions", colClose);
+                cmd->partitionCount = countPos != string::npos ? atoi(sql.c_str() + countPos + 10) : 4;
+            }
+        }
         return cmd;
     }
 
@@ -59,23 +172,30 @@ unique_ptr<Command> Parser::parse(const string &sql)
         auto cmd = make_unique<InsertCommand>();
         cmd->type = CommandType::INSERT;
 
-        // 提取表名
+        // 表名是INTO之后的第一个词，紧随其后的词决定是VALUES还是SELECT，表名或值中含有select不受影响
         size_t intoPos = lower.find("into") + 4;
-        size_t valPos = lower.find("values", intoPos);
-        string tableName = sql.substr(intoPos, valPos - intoPos);
-        cmd->tableName = clean(tableName);
-
-        // 解析值列表
-        size_t lParen = sql.find('(', valPos);
-        size_t rParen = sql.find(')', lParen);
-        string valuesStr = sql.substr(lParen + 1, rParen - lParen - 1);
+        size_t nameBegin = min(lower.find_first_not_of(" \t", intoPos), lower.size());
+        size_t nameEnd = min(lower.find_first_of(" \t(", nameBegin), lower.size());
+        size_t keywordBegin = min(lower.find_first_not_of(" \t", nameEnd), lower.size());
+        size_t keywordEnd = min(lower.find_first_of(" \t(", keywordBegin), lower.size());
 
-        stringstream ss(valuesStr);
-        string val;
-        while (getline(ss, val, ','))
+        // INSERT INTO ... SELECT：查询部分按SELECT语句解析
+        if (lower.compare(keywordBegin, keywordEnd - keywordBegin, "select") == 0)
         {
-            cmd->values.push_back(clean(val));
+            cmd->tableName = clean(sql.substr(nameBegin, nameEnd - nameBegin));
+            auto query = parse(sql.substr(keywordBegin));
+            if (query->type == CommandType::SELECT)
+                cmd->source.reset(static_cast<SelectCommand *>(query.release()));
+            return cmd;
         }
+
+        size_t valPos = lower.find("values", nameEnd);
+        string tableName = sql.substr(intoPos, valPos - intoPos);
+        cmd->tableName = clean(tableName);
+
+        // 解析值列表，一条语句可以包含多个元组
+        if (valPos != string::npos)
+            cmd->rows = parseTuples(sql.substr(valPos + 6));
         return cmd;
     }
 
@@ -86,20 +206,41 @@ unique_ptr<Command> Parser::parse(const string &sql)
         cmd->type = CommandType::SELECT;
 
         // 提取表名和条件
-        size_t fromPos = lower.find("from");
+        size_t fromPos = findKeyword(lower, "from", 6);
         if (fromPos == string::npos)
             return cmd;
 
-        size_t wherePos = lower.find("where", fromPos);
+        // 提取要输出的列
+        string columnList = clean(sql.substr(6, fromPos - 6));
+        if (columnList != "*")
+        {
+            stringstream cols(columnList);
+            string col;
+            while (getline(cols, col, ','))
+                cmd->columns.push_back(clean(col));
+        }
+
+        // 提取GROUP BY的分组列，其余部分按表名和条件解析
+        size_t groupPos = findKeyword(lower, "group by", fromPos + 4);
+        size_t end = groupPos == string::npos ? sql.size() : groupPos;
+        if (groupPos != string::npos)
+        {
+            stringstream groups(sql.substr(groupPos + 8));
+            string col;
+            while (getline(groups, col, ','))
+                cmd->groupBy.push_back(clean(col));
+        }
+
+        size_t wherePos = findKeyword(lower, "where", fromPos + 4);
         string tableName;
-        if (wherePos != string::npos)
+        if (wherePos != string::npos && wherePos < end)
         {
             tableName = sql.substr(fromPos + 4, wherePos - fromPos - 4);
-            cmd->condition = sql.substr(wherePos + 5);
+            cmd->condition = sql.substr(wherePos + 5, end - wherePos - 5);
         }
         else
         {
-            tableName = sql.substr(fromPos + 4);
+            tableName = sql.substr(fromPos + 4, end - fromPos - 4);
         }
         cmd->tableName = clean(tableName);
         return cmd;
@@ -160,12 +301,12 @@ unique_ptr<Command> Parser::parse(const string &sql)
         return cmd;
     }
 
-    // 解析DROP TABLE语句
-    if (lower.find("drop table") == 0)
+    // 解析DROP TABLE语句，DROP MATERIALIZED VIEW按删除表处理
+    if (lower.find("drop table") == 0 || lower.find("drop materialized view") == 0)
     {
         auto cmd = make_unique<DropCommand>();
         cmd->type = CommandType::DROP;
-        size_t start = lower.find("table") + 5;
+        size_t start = lower.find("drop table") == 0 ? lower.find("table") + 5 : lower.find("view") + 4;
         string tableName = sql.substr(start);
         cmd->tableName = clean(tableName);
         return cmd;
@@ -186,6 +327,9 @@ unique_ptr<Command> Parser::parse(const string &sql)
         if (quote1 != string::npos && quote2 != string::npos && quote2 > quote1)
         {
             cmd->filePath = sql.substr(quote1 + 1, quote2 - quote1 - 1);
+            // 可选的FORMAT BINARY子句
+            if (lower.find("format binary", quote2) != string::npos)
+                cmd->format = "binary";
         }
         else
         {
@@ -194,6 +338,109 @@ unique_ptr<Command> Parser::parse(const string &sql)
         return cmd;
     }
 
+    // 解析SHOW STATS语句
+    if (lower.find("show stats") == 0)
+    {
+        auto cmd = make_unique<ShowStatsCommand>();
+        cmd->type = CommandType::SHOW_STATS;
+        return cmd;
+    }
+
+    // 解析ALTER TABLE ... DROP PARTITION p<id>语句
+    if (lower.find("alter table") == 0)
+    {
+        auto cmd = make_unique<DropPartitionCommand>();
+        size_t dropPos = lower.find("drop partition");
+        if (dropPos == string::npos)
+        {
+            cmd->type = CommandType::UNKNOWN;
+            return cmd;
+        }
+        cmd->type = CommandType::DROP_PARTITION;
+        size_t start = lower.find("table") + 5;
+        cmd->tableName = clean(sql.substr(start, dropPos - start));
+        string name = clean(lower.substr(dropPos + 14));
+        if (name.size() > 1 && name[0] == 'p' && all_of(name.begin() + 1, name.end(), ::isdigit))
+            cmd->partitionId = stoi(name.substr(1));
+        return cmd;
+    }
+
+    // 解析COMPACT TABLE语句
+    if (lower.find("compact table") == 0)
+    {
+        auto cmd = make_unique<CompactCommand>();
+        cmd->type = CommandType::COMPACT;
+        size_t start = lower.find("table") + 5;
+        cmd->tableName = clean(sql.substr(start));
+        return cmd;
+    }
+
+    // 解析CREATE BLOOM FILTER ON <table>(<column>)语句
+    if (lower.find("create bloom filter") == 0)
+    {
+        auto cmd = make_unique<CreateBloomCommand>();
+        size_t onPos = lower.find(" on ");
+        size_t open = sql.find('(', onPos == string::npos ? 0 : onPos);
+        size_t close = sql.find(')', open == string::npos ? 0 : open);
+        if (onPos == string::npos || open == string::npos || close == string::npos)
+            return cmd;
+        cmd->type = CommandType::CREATE_BLOOM;
+        cmd->tableName = clean(sql.substr(onPos + 4, open - onPos - 4));
+        cmd->column = clean(sql.substr(open + 1, close - open - 1));
+        return cmd;
+    }
+
+    // 解析ANALYZE [TABLE] <table>语句
+    if (lower.find("analyze ") == 0)
+    {
+        auto cmd = make_unique<AnalyzeCommand>();
+        cmd->type = CommandType::ANALYZE;
+        size_t start = 8;
+        if (clean(lower.substr(start)).find("table ") == 0)
+            start = lower.find("table", start) + 5;
+        cmd->tableName = clean(sql.substr(start));
+        return cmd;
+    }
+
+    // 解析EXPLAIN SELECT ...语句
+    if (lower.find("explain ") == 0)
+    {
+        auto cmd = make_unique<ExplainCommand>();
+        auto query = parse(clean(sql.substr(8)));
+        if (query->type == CommandType::SELECT)
+        {
+            cmd->type = CommandType::EXPLAIN;
+            cmd->query.reset(static_cast<SelectCommand *>(query.release()));
+        }
+        return cmd;
+    }
+
+    // 解析CREATE MATERIALIZED VIEW <view> AS SELECT ...语句
+    if (lower.find("create materialized view") == 0)
+    {
+        auto cmd = make_unique<CreateViewCommand>();
+        size_t start = lower.find("view") + 4;
+        size_t asPos = lower.find(" as ", start);
+        if (asPos == string::npos)
+            return cmd;
+        cmd->viewName = clean(sql.substr(start, asPos - start));
+        cmd->query = clean(sql.substr(asPos + 4));
+        string query = cmd->query;
+        transform(query.begin(), query.end(), query.begin(), ::tolower);
+        if (!cmd->viewName.empty() && query.find("select") == 0)
+            cmd->type = CommandType::CREATE_VIEW;
+        return cmd;
+    }
+
+    // 解析REFRESH MATERIALIZED VIEW <view>语句
+    if (lower.find("refresh materialized view") == 0)
+    {
+        auto cmd = make_unique<RefreshViewCommand>();
+        cmd->type = CommandType::REFRESH_VIEW;
+        cmd->viewName = clean(sql.substr(lower.find("view") + 4));
+        return cmd;
+    }
+
     // 未知命令类型
     auto cmd = make_unique<Command>();
     cmd->type = CommandType::UNKNOWN;
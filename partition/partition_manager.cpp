@@ -0,0 +1,68 @@
+//partition_manager.cpp - 分区管理器实现
+
+#include "partition_manager.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+using namespace std;
+
+// 分区键的规范形式:去除首尾空格和包裹的双引号,使带引号与不带引号的写法落入同一分区
+static string normalizeKey(const string &value)
+{
+    size_t start = value.find_first_not_of(" \t\r\n");
+    if (start == string::npos)
+        return "";
+    size_t end = value.find_last_not_of(" \t\r\n");
+    string s = value.substr(start, end - start + 1);
+    if (s.size() >= 2 && s.front() == '"' && s.back() == '"')
+        s = s.substr(1, s.size() - 2);
+    return s;
+}
+
+static bool parseInt(const string &s, long long &out)
+{
+    if (s.empty())
+        return false;
+    errno = 0;
+    char *end = nullptr;
+    out = strtoll(s.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+// 整数列按数值比较,其余按字典序比较
+static bool lessThan(const string &a, const string &b, bool isInt)
+{
+    long long x = 0, y = 0;
+    if (isInt && parseInt(a, x) && parseInt(b, y))
+        return x < y;
+    return a < b;
+}
+
+// FNV-1a哈希,结果与平台和标准库实现无关,保证重启后路由不变
+static uint64_t stableHash(const string &s)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : s)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int PartitionManager::route(const PartitionSpec &spec, const string &value, bool isInt)
+{
+    if (spec.ids.empty())
+        return -1;
+    string key = normalizeKey(value);
+    if (spec.method == "hash")
+        return spec.ids[stableHash(key) % spec.ids.size()];
+
+    // RANGE分区:落入第一个上界大于该值的分区
+    for (size_t i = 0; i < spec.ids.size(); ++i)
+    {
+        if (spec.bounds[i] == "MAXVALUE" || lessThan(key, spec.bounds[i], isInt))
+            return spec.ids[i];
+    }
+    return -1;
+}
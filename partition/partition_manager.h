@@ -0,0 +1,14 @@
+//partition_manager.h - 分区管理器头文件
+
+#pragma once
+#include "../catalog/catalog_manager.h"
+#include <string>
+using namespace std;
+
+// 分区路由,插入时据此决定记录写入哪个分区,等值查询时据此只扫描可能命中的分区
+class PartitionManager
+{
+public:
+    // 返回分区列取值为value的记录所属的分区编号,没有可容纳该值的分区时返回-1
+    static int route(const PartitionSpec &spec, const string &value, bool isInt);
+};
@@ -1,12 +1,27 @@
 // record_manager.cpp - 记录管理器实现
 
 #include "record_manager.h"
+#include "../bloom/bloom_filter.h"
+#include "../cache/cache_manager.h"
+#include "../catalog/catalog_manager.h"
+#include "../export/export_writer.h"
+#include "../lsm/lsm_manager.h"
+#include "../optimizer/optimizer_manager.h"
+#include "../partition/partition_manager.h"
+#include "../segment/segment_manager.h"
+#include "../stats/stats_manager.h"
+#include "../view/view_manager.h"
 #include <fstream>
 #include <filesystem>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <map>
+#include <memory>
 using namespace std;
 namespace fs = filesystem;
 
@@ -39,25 +54,20 @@ string RecordManager::trim(const string &s)
 vector<string> getTableColumns(const string &tableName)
 {
     vector<string> columns;
-    ifstream meta("metadata/" + tableName + ".meta");
-    string line;
-    while (getline(meta, line))
-    {
-        if (line.find("Columns:") != string::npos)
-            break;
-    }
-    while (getline(meta, line))
-    {
-        if (line.empty())
-            break;
-        stringstream ss(line);
-        string colName;
-        ss >> colName;
-        columns.push_back(colName);
-    }
+    for (const auto &[name, type] : CatalogManager::getColumns(tableName))
+        columns.push_back(name);
     return columns;
 }
 
+// 获取表的字段类型
+vector<string> getColumnTypes(const string &tableName)
+{
+    vector<string> types;
+    for (const auto &[name, type] : CatalogManager::getColumns(tableName))
+        types.push_back(type);
+    return types;
+}
+
 // 获取列名在字段列表中的索引
 int getColumnIndex(const vector<string> &columns, const string &columnName)
 {
@@ -69,134 +79,499 @@ int getColumnIndex(const vector<string> &columns, const string &columnName)
     return -1;
 }
 
-/*insertRecord由大模型生成*/
-// 将数据以tbl格式追加到数据文件中
-bool RecordManager::insertRecord(const string &tableName, const vector<string> &values)
+// 工具函数：去除首尾空格和包裹的双引号，该函数由大模型生成
+string cleanStr(string s)
 {
-    // 确保data目录存在
-    fs::create_directory("data");
+    s = RecordManager::trim(s);
+    if (s.size() >= 2 && s.front() == '"' && s.back() == '"')
+    {
+        s = s.substr(1, s.size() - 2);
+    }
+    return s;
+}
 
-    // 生成数据文件路径，这一小部分由大模型生成
-    string filename = "data/" + tableName + ".tbl";
-    ofstream fout(filename, ios::app); // 以追加模式打开文件
-    if (!fout.is_open())
-        return false;
+// 将一行tbl文本按逗号拆分为字段
+vector<string> splitLine(const string &line)
+{
+    stringstream ss(line);
+    string field;
+    vector<string> row;
+    while (getline(ss, field, ','))
+        row.push_back(field);
+    return row;
+}
 
-    // 将值写入文件，用逗号分隔
-    for (size_t i = 0; i < values.size(); ++i)
+// 将字段用逗号拼接为一行tbl文本
+string joinRow(const vector<string> &row)
+{
+    string line;
+    for (size_t i = 0; i < row.size(); ++i)
     {
-        fout << values[i];
-        if (i != values.size() - 1)
-            fout << ",";
+        line += row[i];
+        if (i != row.size() - 1)
+            line += ",";
     }
-    fout << "\n";
-    fout.close();
-    return true;
+    return line;
 }
 
-// 查询表中的所有记录
-vector<vector<string>> RecordManager::selectAll(const string &tableName)
+// 表结构与分区信息
+struct TableInfo
 {
-    string filename = "data/" + tableName + ".tbl";
-    ifstream fin(filename);
-    vector<vector<string>> result;
+    vector<string> columns;
+    vector<string> types;
+    PartitionSpec partition;
+    int partitionIndex = -1;     // 分区列下标,未分区时为-1
+    bool partitionIsInt = false; // 分区列是否为int类型
+    vector<pair<int, string>> blooms; // 建有Bloom过滤器的列(下标,列名)
+    bool lsm = false;                 // 是否使用LSM存储
+};
 
+TableInfo getTableInfo(const string &tableName)
+{
+    TableInfo info;
+    info.columns = getTableColumns(tableName);
+    info.types = getColumnTypes(tableName);
+    info.partition = CatalogManager::getPartition(tableName);
+    if (!info.partition.method.empty())
+    {
+        info.partitionIndex = getColumnIndex(info.columns, info.partition.column);
+        if (info.partitionIndex >= 0)
+            info.partitionIsInt = info.types[info.partitionIndex] == "int";
+    }
+    info.lsm = CatalogManager::getStorage(tableName) == "lsm";
+    for (const auto &column : CatalogManager::getBloomFilters(tableName))
+    {
+        int index = getColumnIndex(info.columns, column);
+        if (index >= 0)
+            info.blooms.emplace_back(index, column);
+    }
+    return info;
+}
+
+// 存储单元路径:未分区的表只有data/<table>,分区表的每个分区对应data/<table>.p<id>
+// 每个存储单元由文本尾部<base>.tbl与可选的压缩段<base>.seg组成
+string unitPath(const string &tableName, int partitionId)
+{
+    if (partitionId < 0)
+        return "data/" + tableName;
+    return "data/" + tableName + ".p" + to_string(partitionId);
+}
+
+// 表的全部存储单元
+vector<string> allUnits(const string &tableName, const TableInfo &info)
+{
+    if (info.partition.method.empty())
+        return {unitPath(tableName, -1)};
+    vector<string> units;
+    for (int id : info.partition.ids)
+        units.push_back(unitPath(tableName, id));
+    return units;
+}
+
+// 定位一行文本中前count个字段的起止位置,行中字段不足时只返回实际存在的字段
+void locateFields(const string &line, size_t count, vector<pair<size_t, size_t>> &spans)
+{
+    spans.clear();
+    size_t start = 0;
+    while (spans.size() < count && start < line.size())
+    {
+        size_t comma = line.find(',', start);
+        if (comma == string::npos)
+            comma = line.size();
+        spans.emplace_back(start, comma);
+        start = comma + 1;
+    }
+}
+
+// 与RecordManager::trim相同,但不复制字段内容
+string_view trimView(string_view s)
+{
+    size_t begin = s.find_first_not_of(" \t\n\v\f\r");
+    if (begin == string_view::npos)
+        return {};
+    size_t end = s.find_last_not_of(" \t\n\v\f\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+// 逐行读取文本尾部的有效记录,index>=0时只保留该列等于value的记录;needed为需要拆分出的字段数
+// 行缓冲区和字段位置表在各行之间复用,onLine拿到的行只在回调内有效
+void scanTail(const string &base, int index, const string &value, size_t needed,
+              const function<void(const string &, const vector<pair<size_t, size_t>> &)> &onLine)
+{
+    ifstream fin(base + ".tbl");
     if (!fin.is_open())
-        return result;
+        return;
 
+    vector<pair<size_t, size_t>> spans;
+    string target = RecordManager::trim(value);
+    uint64_t scanned = 0, dead = 0, bytes = 0;
     string line;
     while (getline(fin, line))
     {
+        bytes += line.size() + 1;
         // 跳过空行和已删除的记录（以#开头）
-        if (line.empty() || line[0] == '#')
+        if (line.empty())
             continue;
-
-        // 解析行数据
-        stringstream ss(line);
-        string field;
-        vector<string> row;
-        while (getline(ss, field, ','))
+        if (line[0] == '#')
         {
-            row.push_back(field);
+            ++dead;
+            continue;
         }
-        result.push_back(row);
+        ++scanned;
+
+        // 检查指定列的值是否匹配
+        locateFields(line, needed, spans);
+        if (index >= 0 && (spans.size() <= static_cast<size_t>(index) ||
+                           trimView(string_view(line).substr(spans[index].first, spans[index].second - spans[index].first)) != target))
+            continue;
+        onLine(line, spans);
     }
 
-    return result;
+    StatsManager::addRowsScanned(scanned);
+    StatsManager::addDeadRows(dead);
+    StatsManager::addBytesRead(bytes);
 }
 
-// 根据条件查询记录
-vector<vector<string>> RecordManager::selectWhere(const string &tableName, const string &column, const string &value)
+// 需要拆分出的字段数,不投影时拆分整行
+size_t neededFields(int index, const vector<int> &projection)
 {
-    string filename = "data/" + tableName + ".tbl";
-    ifstream fin(filename);
-    vector<vector<string>> result;
-    if (!fin.is_open())
-        return result;
+    if (projection.empty())
+        return SIZE_MAX;
+    size_t needed = index + 1;
+    for (int c : projection)
+        needed = max(needed, static_cast<size_t>(c) + 1);
+    return needed;
+}
+
+// 读取存储单元中的有效记录,先读压缩段再读文本尾部;index>=0时只保留该列等于value的记录
+// projection非空时每行只保留这些列,文本行拆分到最后一个需要的字段即停止
+// 记录逐行交给onRow,不在内存中累积
+void scanUnit(const string &base, int index, const string &value, const vector<int> &projection, const SegmentManager::RowCallback &onRow)
+{
+    if (index < 0)
+        SegmentManager::scan(base + ".seg", onRow, projection);
+    else
+        SegmentManager::scanWhere(base + ".seg", index, value, onRow, projection);
+
+    vector<string> row;
+    scanTail(base, index, value, neededFields(index, projection), [&](const string &line, const vector<pair<size_t, size_t>> &spans)
+             {
+        row.clear();
+        if (projection.empty())
+        {
+            for (const auto &span : spans)
+                row.emplace_back(line, span.first, span.second - span.first);
+        }
+        else
+        {
+            for (int c : projection)
+            {
+                if (static_cast<size_t>(c) < spans.size())
+                    row.emplace_back(line, spans[c].first, spans[c].second - spans[c].first);
+                else
+                    row.emplace_back();
+            }
+        }
+        onRow(row); });
+}
 
-    // 工具函数：去除首尾空格和包裹的双引号，该函数由大模型生成
-    auto cleanStr = [&](string s) -> string
+// 与scanUnit相同,但记录追加到批中:文本尾部的字段直接从行缓冲区拷入批的连续缓冲区,不为每个字段分配字符串
+// onFull非空时批中攒满kBatchRows行就交给它处理并清空,否则整个存储单元的记录都留在out中
+constexpr size_t kBatchRows = 4096;
+
+void scanUnitBatch(const string &base, int index, const string &value, const vector<int> &projection, RowBatch &out,
+                   const function<void(RowBatch &)> &onFull = nullptr)
+{
+    auto checkFull = [&]()
     {
-        s = RecordManager::trim(s);
-        if (s.size() >= 2 && s.front() == '"' && s.back() == '"')
+        if (onFull && out.size() >= kBatchRows)
         {
-            s = s.substr(1, s.size() - 2);
+            onFull(out);
+            out.clear();
         }
-        return s;
     };
+    auto addRow = [&](vector<string> &row)
+    {
+        out.addRow(row);
+        checkFull();
+    };
+    if (index < 0)
+        SegmentManager::scan(base + ".seg", addRow, projection);
+    else
+        SegmentManager::scanWhere(base + ".seg", index, value, addRow, projection);
 
-    string cleanedValue = cleanStr(value);
+    scanTail(base, index, value, neededFields(index, projection), [&](const string &line, const vector<pair<size_t, size_t>> &spans)
+             {
+        string_view text(line);
+        if (projection.empty())
+        {
+            for (const auto &span : spans)
+                out.addField(text.substr(span.first, span.second - span.first));
+        }
+        else
+        {
+            for (int c : projection)
+                out.addField(static_cast<size_t>(c) < spans.size() ? text.substr(spans[c].first, spans[c].second - spans[c].first) : string_view());
+        }
+        out.endRow();
+        checkFull(); });
+}
 
-    // 从元数据文件获取字段名
-    vector<string> columns = getTableColumns(tableName);
-    int index = getColumnIndex(columns, column);
-    if (index == -1)
-        return result;
+uint64_t fileSize(const string &path)
+{
+    error_code ec;
+    uint64_t size = fs::file_size(path, ec);
+    return ec ? 0 : size;
+}
 
-    // 扫描数据文件并匹配条件
-    string line;
-    while (getline(fin, line))
+// 重新建立存储单元上的全部Bloom过滤器,按实际记录数确定过滤器大小
+void rebuildFilters(const string &base, const TableInfo &info)
+{
+    if (info.blooms.empty())
+        return;
+    uint64_t tailBytes = fileSize(base + ".tbl");
+    uint64_t segmentBytes = fileSize(base + ".seg");
+    vector<vector<uint64_t>> hashes(info.blooms.size());
+    scanUnit(base, -1, "", {}, [&](vector<string> &row)
+             {
+        for (size_t i = 0; i < info.blooms.size(); ++i)
+        {
+            if (row.size() > static_cast<size_t>(info.blooms[i].first))
+                hashes[i].push_back(BloomFilter::hash(RecordManager::trim(row[info.blooms[i].first])));
+        } });
+    for (size_t i = 0; i < info.blooms.size(); ++i)
     {
-        if (line.empty() || line[0] == '#')
+        BloomFilter filter(hashes[i].size() * 2);
+        for (uint64_t h : hashes[i])
+            filter.addHash(h);
+        filter.tailBytes = tailBytes;
+        filter.segmentBytes = segmentBytes;
+        BloomManager::store(base, info.blooms[i].second, move(filter));
+    }
+}
+
+// 取得存储单元上index列的过滤器,并补充过滤器建立后(如上次运行结束前未写回)追加到文本尾部的记录
+BloomFilter *unitFilter(const string &base, int index, const string &column)
+{
+    BloomFilter *filter = BloomManager::find(base, column);
+    if (!filter)
+        return nullptr;
+    uint64_t size = fileSize(base + ".tbl");
+    if (filter->tailBytes < size)
+    {
+        ifstream fin(base + ".tbl");
+        fin.seekg(filter->tailBytes);
+        string line;
+        while (getline(fin, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            vector<string> row = splitLine(line);
+            if (row.size() > static_cast<size_t>(index))
+                filter->add(RecordManager::trim(row[index]));
+        }
+        filter->tailBytes = size;
+        filter->dirty = true;
+    }
+    return filter;
+}
+
+// 等值条件可能命中的存储单元,条件列是分区列时只保留该值所在的分区
+// 条件列建有Bloom过滤器时再去掉一定不含该值的存储单元,skipped记录去掉的个数;
+// 统计信息估计每个存储单元都含有该值时不探测过滤器,bypassed记为true
+vector<string> candidateUnits(const string &tableName, const TableInfo &info, int index, const string &value,
+                              size_t *skipped = nullptr, bool *bypassed = nullptr)
+{
+    vector<string> units;
+    if (info.partitionIndex < 0 || index != info.partitionIndex)
+        units = allUnits(tableName, info);
+    else
+    {
+        int id = PartitionManager::route(info.partition, value, info.partitionIsInt);
+        if (id < 0)
+            return {};
+        units.push_back(unitPath(tableName, id));
+    }
+
+    auto bloom = find_if(info.blooms.begin(), info.blooms.end(), [index](const pair<int, string> &b)
+                         { return b.first == index; });
+    if (bloom == info.blooms.end())
+        return units;
+    if (!OptimizerManager::probeBloomFilters(tableName, index, value, units.size()))
+    {
+        if (bypassed)
+            *bypassed = true;
+        return units;
+    }
+    string key = RecordManager::trim(value);
+    vector<string> kept;
+    for (const auto &base : units)
+    {
+        BloomFilter *filter = unitFilter(base, index, bloom->second);
+        if (filter && !filter->mightContain(key))
+        {
+            if (skipped)
+                ++*skipped;
             continue;
+        }
+        kept.push_back(base);
+    }
+    return kept;
+}
 
-        stringstream ss(line);
-        string field;
-        vector<string> row;
+// 流式读取表中满足条件的记录，LSM表合并读取各有序文件，其余表依次读取各存储单元
+void scanTable(const string &tableName, const TableInfo &info, int index, const string &value,
+               const vector<int> &projection, const SegmentManager::RowCallback &onRow)
+{
+    if (info.lsm)
+    {
+        LsmManager::scan(tableName, index, value, projection, onRow);
+        return;
+    }
+    vector<string> units = index < 0 ? allUnits(tableName, info) : candidateUnits(tableName, info, index, value);
+    for (const auto &base : units)
+        scanUnit(base, index, value, projection, onRow);
+}
 
-        while (getline(ss, field, ','))
-            row.push_back(field);
+// 与scanTable相同,但记录按批交给onBatch,每批不超过kBatchRows行
+void scanTableBatches(const string &tableName, const TableInfo &info, const function<void(RowBatch &)> &onBatch)
+{
+    RowBatch batch;
+    if (info.lsm)
+    {
+        LsmManager::scan(tableName, -1, "", {}, [&](vector<string> &row)
+                         {
+            batch.addRow(row);
+            if (batch.size() >= kBatchRows)
+            {
+                onBatch(batch);
+                batch.clear();
+            } });
+    }
+    else
+    {
+        for (const auto &base : allUnits(tableName, info))
+            scanUnitBatch(base, -1, "", {}, batch, onBatch);
+    }
+    if (!batch.empty())
+        onBatch(batch);
+}
 
-        // 检查指定列的值是否匹配
-        if (row.size() > index && RecordManager::trim(row[index]) == RecordManager::trim(cleanedValue))
+// 按计划扫描多个存储单元,分区表的各分区并行扫描到各自的批中,结果按分区顺序拼接
+RowBatch scanUnits(const ScanPlan &plan, int index, const string &value, const vector<int> &projection)
+{
+    const vector<string> &units = plan.units;
+    vector<RowBatch> parts(units.size());
+    auto scanOne = [&](size_t i)
+    {
+        scanUnitBatch(units[i], index, value, projection, parts[i]);
+    };
+    size_t workers = plan.workers;
+    if (workers <= 1)
+    {
+        for (size_t i = 0; i < units.size(); ++i)
+            scanOne(i);
+    }
+    else
+    {
+        atomic<size_t> next{0};
+        vector<thread> pool;
+        for (size_t w = 0; w < workers; ++w)
         {
-            result.push_back(row);
+            pool.emplace_back([&]()
+                              {
+                for (size_t i = next++; i < units.size(); i = next++)
+                    scanOne(plan.order[i]); });
         }
+        for (auto &t : pool)
+            t.join();
     }
 
+    RowBatch result;
+    for (auto &part : parts)
+    {
+        if (result.empty())
+            result = move(part);
+        else
+            result.append(part);
+    }
     return result;
 }
 
-// 根据条件删除记录
-int RecordManager::deleteWhere(const string &tableName, const string &column, const string &value)
+// 按行改写压缩段:apply返回true表示该行命中条件(index列等于value),将drop置为true可丢弃该行;返回命中行数
+int rewriteSegment(const string &base, const vector<string> &types, int index, const string &value,
+                   const function<bool(vector<string> &, bool &)> &apply)
 {
-    string filename = "data/" + tableName + ".tbl";
-    ifstream fin(filename);
-    vector<string> lines;
-    if (!fin.is_open())
+    string segFile = base + ".seg";
+    if (!fs::exists(segFile))
         return 0;
 
-    // 从元数据文件获取字段名
-    vector<string> columns = getTableColumns(tableName);
-    int index = getColumnIndex(columns, column);
-    if (index == -1)
+    // 先在编码数据上判断是否有记录命中,没有命中时不解码也不重写整个段
+    bool hit = false;
+    SegmentManager::scanWhere(segFile, index, value, [&](vector<string> &)
+                              { hit = true; }, {index});
+    if (!hit)
+        return 0;
+    string tmpFile = segFile + ".tmp";
+    SegmentWriter writer(tmpFile, types);
+    if (!writer.isOpen())
+        return 0;
+    int count = 0;
+    bool ok = SegmentManager::scan(segFile, [&](vector<string> &row)
+                                   {
+        bool drop = false;
+        if (apply(row, drop))
+            ++count;
+        if (!drop)
+            writer.add(row); });
+    if (!writer.finish() || !ok || count == 0)
+    {
+        fs::remove(tmpFile);
         return 0;
+    }
+    fs::rename(tmpFile, segFile);
+    StatsManager::addBytesWritten(writer.bytesWritten());
+    return count;
+}
+
+// 重写文本尾部
+void rewriteTail(const string &filename, const vector<string> &lines)
+{
+    ofstream fout(filename);
+    uint64_t written = 0;
+    for (const auto &l : lines)
+    {
+        fout << l << "\n";
+        written += l.size() + 1;
+    }
+    StatsManager::addBytesWritten(written);
+}
+
+// 删除存储单元中index列等于value的记录,removed非空时收集被删除的记录;返回删除数
+int deleteInUnit(const string &base, const vector<string> &types, int index, const string &value, vector<vector<string>> *removed)
+{
+    // 压缩段中命中的记录直接从段中移除
+    int count = rewriteSegment(base, types, index, value, [&](vector<string> &row, bool &drop)
+                               {
+        if (RecordManager::trim(row[index]) != RecordManager::trim(value))
+            return false;
+        if (removed)
+            removed->push_back(row);
+        return drop = true; });
+
+    string filename = base + ".tbl";
+    ifstream fin(filename);
+    if (!fin.is_open())
+        return count;
 
     // 处理每一行数据
-    int count = 0;
+    vector<string> lines;
+    int tailCount = 0;
+    uint64_t scanned = 0, dead = 0, bytes = 0;
     string line;
     while (getline(fin, line))
     {
+        bytes += line.size() + 1;
         if (line.empty())
         {
             lines.push_back(line);
@@ -204,59 +579,66 @@ int RecordManager::deleteWhere(const string &tableName, const string &column, co
         }
         if (line[0] == '#')
         {
+            ++dead;
             lines.push_back(line);
             continue;
         }
+        ++scanned;
 
         // 解析行数据
-        stringstream ss(line);
-        string field;
-        vector<string> row;
-
-        while (getline(ss, field, ','))
-            row.push_back(field);
+        vector<string> row = splitLine(line);
 
         // 检查是否匹配删除条件
         if (row.size() > index && RecordManager::trim(row[index]) == RecordManager::trim(value))
         {
             lines.push_back("#" + line); // 标记为删除
-            count++;
+            tailCount++;
+            if (removed)
+                removed->push_back(move(row));
         }
         else
         {
             lines.push_back(line);
         }
     }
-
-    // 重写文件
     fin.close();
-    ofstream fout(filename);
-    for (const auto &l : lines)
-        fout << l << "\n";
-    return count;
+    StatsManager::addRowsScanned(scanned);
+    StatsManager::addDeadRows(dead);
+    StatsManager::addBytesRead(bytes);
+
+    // 有记录被删除时才重写文件
+    if (tailCount > 0)
+        rewriteTail(filename, lines);
+    return count + tailCount;
 }
 
-// 根据条件更新记录
-int RecordManager::updateWhere(const string &tableName, const string &setColumn, const string &setValue, const string &whereColumn, const string &whereValue)
+// 更新存储单元中whereIdx列等于whereValue的记录,before非空时收集更新前的记录;返回更新数
+int updateInUnit(const string &base, const vector<string> &types, int setIdx, const string &setValue, int whereIdx, const string &whereValue,
+                 vector<vector<string>> *before)
 {
-    string filename = "data/" + tableName + ".tbl";
+    // 改写压缩段中命中的记录
+    int count = rewriteSegment(base, types, whereIdx, whereValue, [&](vector<string> &row, bool &)
+                               {
+        if (RecordManager::trim(row[whereIdx]) != RecordManager::trim(whereValue))
+            return false;
+        if (before)
+            before->push_back(row);
+        row[setIdx] = setValue;
+        return true; });
+
+    string filename = base + ".tbl";
     ifstream fin(filename);
-    vector<string> lines;
     if (!fin.is_open())
-        return 0;
-
-    // 从元数据文件获取字段名
-    vector<string> columns = getTableColumns(tableName);
-    int setIdx = getColumnIndex(columns, setColumn);
-    int whereIdx = getColumnIndex(columns, whereColumn);
-    if (setIdx == -1 || whereIdx == -1)
-        return 0;
+        return count;
 
     // 处理每一行数据，该部分由大模型生成
-    int count = 0;
+    vector<string> lines;
+    int tailCount = 0;
+    uint64_t scanned = 0, dead = 0, bytes = 0;
     string line;
     while (getline(fin, line))
     {
+        bytes += line.size() + 1;
         if (line.empty())
         {
             lines.push_back(line);
@@ -264,91 +646,668 @@ int RecordManager::updateWhere(const string &tableName, const string &setColumn,
         }
         if (line[0] == '#')
         {
+            ++dead;
             lines.push_back(line);
             continue;
         }
-        stringstream ss(line);
-        string field;
-        vector<string> row;
-        while (getline(ss, field, ','))
-            row.push_back(field);
+        ++scanned;
+        vector<string> row = splitLine(line);
         if (row.size() > whereIdx && RecordManager::trim(row[whereIdx]) == RecordManager::trim(whereValue))
         {
             if (row.size() > setIdx)
             {
+                if (before)
+                    before->push_back(row);
                 row[setIdx] = setValue;
-                count++;
+                tailCount++;
             }
         }
         // 重新拼接行
-        string newline;
-        for (size_t i = 0; i < row.size(); ++i)
-        {
-            newline += row[i];
-            if (i != row.size() - 1)
-                newline += ",";
-        }
-        lines.push_back(newline);
+        lines.push_back(joinRow(row));
     }
     fin.close();
-    ofstream fout(filename);
-    for (const auto &l : lines)
-        fout << l << "\n";
-    return count;
+    StatsManager::addRowsScanned(scanned);
+    StatsManager::addDeadRows(dead);
+    StatsManager::addBytesRead(bytes);
+
+    if (tailCount > 0)
+        rewriteTail(filename, lines);
+    return count + tailCount;
 }
 
-// 导出表为CSV文件
-bool RecordManager::exportToCSV(const string &tableName, const string &filePath)
+// 将存储单元中的有效记录合并编码为新的压缩段,字段数与表结构不符的记录仍保留在尾部
+int compactUnit(const string &base, const vector<string> &types)
 {
-    // 读取字段名
-    vector<string> columns = getTableColumns(tableName);
-    if (columns.empty())
-        return false;
+    string segFile = base + ".seg";
+    string tmpFile = segFile + ".tmp";
+    SegmentWriter writer(tmpFile, types);
+    if (!writer.isOpen())
+        return -1;
+    SegmentManager::scan(segFile, [&](vector<string> &row)
+                         { writer.add(row); });
 
-    // 读取所有数据记录
-    string dataFile = "data/" + tableName + ".tbl";
+    string dataFile = base + ".tbl";
     ifstream fin(dataFile);
-    if (!fin.is_open())
-        return false;
-    vector<vector<string>> records;
+    vector<string> leftovers;
+    uint64_t scanned = 0, dead = 0, bytes = 0;
     string line;
     while (getline(fin, line))
     {
-        if (line.empty() || line[0] == '#')
+        bytes += line.size() + 1;
+        if (line.empty())
             continue;
-        stringstream ss(line);
-        string field;
-        vector<string> row;
-        while (getline(ss, field, ','))
+        if (line[0] == '#')
         {
-            row.push_back(field);
+            ++dead;
+            continue;
         }
-        records.push_back(row);
+        ++scanned;
+        vector<string> row = splitLine(line);
+        if (row.size() == types.size())
+            writer.add(row);
+        else
+            leftovers.push_back(line);
     }
+    fin.close();
+    StatsManager::addRowsScanned(scanned);
+    StatsManager::addDeadRows(dead);
+    StatsManager::addBytesRead(bytes);
 
-    // 写入CSV文件
-    ofstream fout(filePath);
-    if (!fout.is_open())
-        return false;
-    // 写表头
-    for (size_t i = 0; i < columns.size(); ++i)
+    if (!writer.finish())
     {
-        fout << columns[i];
-        if (i != columns.size() - 1)
-            fout << ",";
+        fs::remove(tmpFile);
+        return -1;
     }
-    fout << "\n";
-    // 写数据
-    for (const auto &row : records)
+    fs::rename(tmpFile, segFile);
+    StatsManager::addBytesWritten(writer.bytesWritten());
+
+    // 尾部只保留未能编码的记录，已删除的记录随之清除
+    rewriteTail(dataFile, leftovers);
+    return static_cast<int>(writer.rowCount());
+}
+
+// 批量追加写入器：按分区路由记录，每个存储单元只打开一次文件，记录先在内存中拼接再整块写出
+class RowAppender
+{
+public:
+    RowAppender(const string &tableName, const TableInfo &info)
+        : tableName(tableName), info(info), stats(OptimizerManager::getStats(tableName)),
+          views(ViewManager::track(tableName)) {}
+
+    ~RowAppender() { finish(); }
+
+    // 记录应写入的分区，未分区的表为-1，没有可容纳该记录的分区时返回false
+    bool route(const vector<string> &row, int &partitionId) const
+    {
+        partitionId = -1;
+        if (info.partition.method.empty())
+            return true;
+        if (info.partitionIndex < 0 || row.size() <= static_cast<size_t>(info.partitionIndex))
+            return false;
+        partitionId = PartitionManager::route(info.partition, row[info.partitionIndex], info.partitionIsInt);
+        return partitionId >= 0;
+    }
+
+    bool add(const vector<string> &row)
+    {
+        int partitionId = -1;
+        if (!route(row, partitionId))
+            return false;
+        // LSM表写入已存在的键会覆盖旧版本:行数不变,旧版本从物化视图中撤销
+        vector<string> old;
+        bool replaced = info.lsm && (stats || views) && !row.empty() &&
+                        LsmManager::get(tableName, RecordManager::trim(row[0]), old);
+        if (stats)
+        {
+            if (replaced)
+                stats->touchRows(1);
+            else
+                stats->addRow(row);
+        }
+        added = true;
+        if (views)
+        {
+            if (replaced)
+                ViewManager::onDelete(tableName, old);
+            ViewManager::onInsert(tableName, row);
+        }
+        if (info.lsm)
+            return ok = LsmManager::put(tableName, row) && ok;
+        for (const auto &[filter, index] : filtersFor(partitionId))
+        {
+            if (row.size() > static_cast<size_t>(index))
+                filter->add(RecordManager::trim(row[index]));
+        }
+        string &buffer = buffers[partitionId];
+        buffer += joinRow(row);
+        buffer.push_back('\n');
+        if (buffer.size() >= kFlushBytes)
+            flush(partitionId, buffer);
+        return ok;
+    }
+
+    bool finish()
+    {
+        // 表的内容已变化,缓存的查询结果失效
+        if (added)
+            CacheManager::bumpVersion(tableName);
+        added = false;
+        if (views)
+            ViewManager::commit(tableName);
+        if (info.lsm)
+            return ok = LsmManager::sync(tableName) && ok;
+        for (auto &[partitionId, buffer] : buffers)
+            flush(partitionId, buffer);
+        files.clear();
+
+        // 过滤器中的键数超过容量两倍后误判率明显上升,按实际记录数重建
+        for (auto &[partitionId, filters] : unitFilters)
+        {
+            bool full = any_of(filters.begin(), filters.end(), [](const pair<BloomFilter *, int> &f)
+                               { return f.first->keyCount() > 2 * f.first->capacity(); });
+            if (full)
+                rebuildFilters(unitPath(tableName, partitionId), info);
+        }
+        unitFilters.clear();
+        return ok;
+    }
+
+private:
+    static constexpr size_t kFlushBytes = 1 << 20;
+
+    void flush(int partitionId, string &buffer)
+    {
+        if (buffer.empty())
+            return;
+        auto &file = files[partitionId];
+        if (!file)
+            file = make_unique<ofstream>(unitPath(tableName, partitionId) + ".tbl", ios::app); // 以追加模式打开文件
+        file->write(buffer.data(), buffer.size());
+        file->flush();
+        ok = ok && static_cast<bool>(*file);
+        for (const auto &[filter, index] : filtersFor(partitionId))
+        {
+            filter->tailBytes += buffer.size();
+            filter->dirty = true;
+        }
+        StatsManager::addBytesWritten(buffer.size());
+        buffer.clear();
+    }
+
+    // 存储单元上需要维护的Bloom过滤器及其列下标,第一次写入该单元时取得
+    const vector<pair<BloomFilter *, int>> &filtersFor(int partitionId)
+    {
+        auto it = unitFilters.find(partitionId);
+        if (it != unitFilters.end())
+            return it->second;
+        vector<pair<BloomFilter *, int>> filters;
+        for (const auto &[index, column] : info.blooms)
+        {
+            if (BloomFilter *filter = unitFilter(unitPath(tableName, partitionId), index, column))
+                filters.emplace_back(filter, index);
+        }
+        return unitFilters.emplace(partitionId, move(filters)).first->second;
+    }
+
+    const string &tableName;
+    const TableInfo &info;
+    TableStats *stats; // 表已ANALYZE时增量更新其统计信息
+    bool views;        // 是否有依赖该表的物化视图
+    bool added = false; // 上次finish后是否写入过记录
+    map<int, vector<pair<BloomFilter *, int>>> unitFilters;
+    map<int, string> buffers;
+    map<int, unique_ptr<ofstream>> files;
+    bool ok = true;
+};
+
+// LSM表的删除：找出命中的记录，为它们的键写入删除标记
+int deleteLsm(const string &tableName, const TableInfo &info, int index, const string &value)
+{
+    // 有物化视图时需要完整的记录，否则只读取键列
+    bool views = ViewManager::track(tableName);
+    vector<string> keys;
+    scanTable(tableName, info, index, value, views ? vector<int>() : vector<int>{0}, [&](vector<string> &row)
+              {
+        keys.push_back(RecordManager::trim(row[0]));
+        if (views)
+            ViewManager::onDelete(tableName, row); });
+    for (const auto &key : keys)
+        LsmManager::remove(tableName, key);
+    LsmManager::sync(tableName);
+    ViewManager::commit(tableName);
+    if (!keys.empty())
+        CacheManager::bumpVersion(tableName);
+    if (TableStats *stats = OptimizerManager::getStats(tableName))
+        stats->removeRows(keys.size());
+    return static_cast<int>(keys.size());
+}
+
+// LSM表的更新：命中的记录写入新版本，修改键列时先为旧键写入删除标记
+int updateLsm(const string &tableName, const TableInfo &info, int setIdx, const string &setValue, int whereIdx, const string &whereValue)
+{
+    bool views = ViewManager::track(tableName);
+    vector<vector<string>> rows;
+    scanTable(tableName, info, whereIdx, whereValue, {}, [&](vector<string> &row)
+              { rows.push_back(move(row)); });
+    int count = 0;
+    for (auto &row : rows)
     {
-        for (size_t i = 0; i < row.size(); ++i)
+        if (row.size() <= static_cast<size_t>(setIdx))
+            continue;
+        if (views)
+            ViewManager::onDelete(tableName, row);
+        if (setIdx == 0)
         {
-            fout << row[i];
-            if (i != row.size() - 1)
-                fout << ",";
+            LsmManager::remove(tableName, RecordManager::trim(row[0]));
+            // 新键已存在时其记录被覆盖
+            vector<string> replaced;
+            if (views && LsmManager::get(tableName, RecordManager::trim(setValue), replaced))
+                ViewManager::onDelete(tableName, replaced);
         }
-        fout << "\n";
+        row[setIdx] = setValue;
+        LsmManager::put(tableName, row);
+        if (views)
+            ViewManager::onInsert(tableName, row);
+        ++count;
+    }
+    LsmManager::sync(tableName);
+    ViewManager::commit(tableName);
+    if (count > 0)
+        CacheManager::bumpVersion(tableName);
+    if (TableStats *stats = OptimizerManager::getStats(tableName))
+        stats->touchRows(count);
+    return count;
+}
+
+/*insertRecord由大模型生成*/
+// 将数据以tbl格式追加到数据文件中
+bool RecordManager::insertRecord(const string &tableName, const vector<string> &values)
+{
+    return insertRecords(tableName, {values}) == 1;
+}
+
+// 批量插入，先检查所有记录都能路由到分区，再一次性追加写入
+int RecordManager::insertRecords(const string &tableName, const vector<vector<string>> &rows)
+{
+    // 确保data目录存在
+    fs::create_directory("data");
+
+    TableInfo info = getTableInfo(tableName);
+    RowAppender appender(tableName, info);
+    int partitionId = -1;
+    for (const auto &row : rows)
+    {
+        if (!appender.route(row, partitionId))
+            return -1;
+    }
+    for (const auto &row : rows)
+        appender.add(row);
+    return appender.finish() ? static_cast<int>(rows.size()) : -1;
+}
+
+// 将查询结果流式写入目标表，读取与写入之间不物化整个结果集
+int RecordManager::insertSelect(const string &tableName, const string &sourceTable, const vector<int> &projection,
+                                const string &whereColumn, const string &whereValue)
+{
+    fs::create_directory("data");
+
+    TableInfo source = getTableInfo(sourceTable);
+    if (source.columns.empty())
+        return -1;
+    int index = -1;
+    string value = cleanStr(whereValue);
+    if (!whereColumn.empty())
+    {
+        index = getColumnIndex(source.columns, whereColumn);
+        if (index == -1)
+            return -1;
+    }
+    TableInfo target = getTableInfo(tableName);
+    RowAppender appender(tableName, target);
+    int count = 0;
+    bool failed = false;
+    auto append = [&](vector<string> &row)
+    {
+        if (failed)
+            return;
+        if (appender.add(row))
+            ++count;
+        else
+            failed = true;
+    };
+    if (tableName == sourceTable)
+    {
+        // 源表与目标表相同时先读完再写，避免读到本次写入的记录
+        vector<vector<string>> rows;
+        scanTable(sourceTable, source, index, value, projection, [&](vector<string> &row)
+                  { rows.push_back(move(row)); });
+        for (auto &row : rows)
+            append(row);
+    }
+    else
+    {
+        scanTable(sourceTable, source, index, value, projection, append);
+    }
+    if (!appender.finish() || failed)
+        return -1;
+    return count;
+}
+
+// 查询表中的所有记录
+RowBatch RecordManager::selectAll(const string &tableName, const vector<int> &projection)
+{
+    TableInfo info = getTableInfo(tableName);
+    if (info.lsm)
+    {
+        RowBatch result;
+        scanTable(tableName, info, -1, "", projection, [&](vector<string> &row)
+                  { result.addRow(row); });
+        return result;
+    }
+    vector<string> units = allUnits(tableName, info);
+    return scanUnits(OptimizerManager::planScan(tableName, units, units.size(), -1, ""), -1, "", projection);
+}
+
+// 根据条件查询记录
+RowBatch RecordManager::selectWhere(const string &tableName, const string &column, const string &value, const vector<int> &projection)
+{
+    RowBatch result;
+    string cleanedValue = cleanStr(value);
+
+    // 从元数据文件获取字段名
+    TableInfo info = getTableInfo(tableName);
+    int index = getColumnIndex(info.columns, column);
+    if (index == -1)
+        return result;
+
+    if (info.lsm)
+    {
+        scanTable(tableName, info, index, cleanedValue, projection, [&](vector<string> &row)
+                  { result.addRow(row); });
+        return result;
+    }
+
+    // 条件列是分区列时只扫描对应分区，Bloom过滤器排除一定不含该值的存储单元，压缩段直接在编码数据上比较
+    ScanPlan plan = OptimizerManager::planScan(tableName, candidateUnits(tableName, info, index, cleanedValue),
+                                               allUnits(tableName, info).size(), index, cleanedValue);
+    return scanUnits(plan, index, cleanedValue, projection);
+}
+
+// 逐行读取满足条件的记录，不在内存中累积
+bool RecordManager::forEachRow(const string &tableName, const string &column, const string &value,
+                               const function<void(vector<string> &)> &onRow)
+{
+    TableInfo info = getTableInfo(tableName);
+    if (info.columns.empty())
+        return false;
+    int index = -1;
+    if (!column.empty())
+    {
+        index = getColumnIndex(info.columns, column);
+        if (index == -1)
+            return false;
+    }
+    scanTable(tableName, info, index, cleanStr(value), {}, onRow);
+    return true;
+}
+
+// 生成查询计划，表或条件列不存在时返回false
+bool RecordManager::planSelect(const string &tableName, const string &column, const string &value, ScanPlan &plan)
+{
+    TableInfo info = getTableInfo(tableName);
+    if (info.columns.empty())
+        return false;
+    if (info.lsm)
+    {
+        // LSM表没有存储单元，键列等值条件按键查找，其余条件合并扫描内存表和全部有序文件
+        int index = column.empty() ? -1 : getColumnIndex(info.columns, column);
+        if (!column.empty() && index == -1)
+            return false;
+        plan = ScanPlan();
+        plan.lsm = true;
+        plan.totalUnits = LsmManager::runCount(tableName);
+        plan.pointLookup = index == 0;
+        double estimate = OptimizerManager::estimateRows(tableName, index, cleanStr(value));
+        plan.analyzed = estimate >= 0;
+        plan.rows = max(estimate, 0.0);
+        if (plan.analyzed)
+            plan.tableRows = static_cast<double>(OptimizerManager::getStats(tableName)->rows);
+        return true;
+    }
+    vector<string> units = allUnits(tableName, info);
+    if (column.empty())
+    {
+        plan = OptimizerManager::planScan(tableName, units, units.size(), -1, "");
+        return true;
+    }
+    int index = getColumnIndex(info.columns, column);
+    if (index == -1)
+        return false;
+    string cleanedValue = cleanStr(value);
+    size_t skipped = 0;
+    bool bypassed = false;
+    plan = OptimizerManager::planScan(tableName, candidateUnits(tableName, info, index, cleanedValue, &skipped, &bypassed),
+                                      units.size(), index, cleanedValue);
+    plan.skippedUnits = skipped;
+    plan.bloomBypassed = bypassed;
+    if (skipped > 0 || bypassed)
+        plan.bloomColumn = column;
+    return true;
+}
+
+// 在column列上建立Bloom过滤器，并为已有的每个存储单元生成过滤器文件
+bool RecordManager::createBloomFilter(const string &tableName, const string &column)
+{
+    // LSM表的数据不按存储单元组织，不支持Bloom过滤器
+    if (CatalogManager::getStorage(tableName) == "lsm" || !CatalogManager::addBloomFilter(tableName, column))
+        return false;
+    TableInfo info = getTableInfo(tableName);
+    for (const auto &base : allUnits(tableName, info))
+        rebuildFilters(base, info);
+    return true;
+}
+
+// 收集表的统计信息，返回统计的记录数，表不存在时返回-1
+int RecordManager::analyzeTable(const string &tableName)
+{
+    vector<pair<string, string>> columns = CatalogManager::getColumns(tableName);
+    if (columns.empty())
+        return -1;
+    TableInfo info = getTableInfo(tableName);
+    StatsBuilder builder(columns);
+    scanTable(tableName, info, -1, "", {}, [&](vector<string> &row)
+              { builder.add(row); });
+    TableStats stats = builder.finish();
+    if (!OptimizerManager::saveStats(tableName, stats))
+        return -1;
+    return static_cast<int>(stats.rows);
+}
+
+// 根据条件删除记录
+int RecordManager::deleteWhere(const string &tableName, const string &column, const string &value)
+{
+    // 从元数据文件获取字段名
+    TableInfo info = getTableInfo(tableName);
+    int index = getColumnIndex(info.columns, column);
+    if (index == -1)
+        return 0;
+
+    if (info.lsm)
+        return deleteLsm(tableName, info, index, value);
+
+    // 删除会改写压缩段和文本尾部，改动过的存储单元重建其Bloom过滤器；有物化视图时收集删除的记录
+    bool views = ViewManager::track(tableName);
+    vector<vector<string>> deleted;
+    int count = 0;
+    for (const auto &base : candidateUnits(tableName, info, index, value))
+    {
+        int removed = deleteInUnit(base, info.types, index, value, views ? &deleted : nullptr);
+        if (removed > 0)
+            rebuildFilters(base, info);
+        count += removed;
+    }
+    for (const auto &row : deleted)
+        ViewManager::onDelete(tableName, row);
+    ViewManager::commit(tableName);
+    if (count > 0)
+        CacheManager::bumpVersion(tableName);
+    if (TableStats *stats = OptimizerManager::getStats(tableName))
+        stats->removeRows(count);
+    return count;
+}
+
+// 删除分区只需删除文件;有物化视图或统计信息时先读出分区中的记录,目录更新成功后再从中撤销
+bool RecordManager::dropPartition(const string &tableName, int partitionId)
+{
+    TableInfo info = getTableInfo(tableName);
+    const vector<int> &ids = info.partition.ids;
+    if (info.partition.method != "range" || find(ids.begin(), ids.end(), partitionId) == ids.end())
+        return false;
+
+    bool views = ViewManager::track(tableName);
+    TableStats *stats = OptimizerManager::getStats(tableName);
+    vector<vector<string>> dropped;
+    uint64_t count = 0;
+    if (views || stats)
+    {
+        scanUnit(unitPath(tableName, partitionId), -1, "", views ? vector<int>() : vector<int>{0}, [&](vector<string> &row)
+                 {
+            ++count;
+            if (views)
+                dropped.push_back(move(row)); });
     }
-    fout.close();
+    if (!CatalogManager::dropPartition(tableName, partitionId))
+        return false;
+    for (const auto &row : dropped)
+        ViewManager::onDelete(tableName, row);
+    ViewManager::commit(tableName);
+    if (stats)
+        stats->removeRows(count);
     return true;
 }
+
+// 根据条件更新记录
+int RecordManager::updateWhere(const string &tableName, const string &setColumn, const string &setValue, const string &whereColumn, const string &whereValue)
+{
+    // 从元数据文件获取字段名
+    TableInfo info = getTableInfo(tableName);
+    int setIdx = getColumnIndex(info.columns, setColumn);
+    int whereIdx = getColumnIndex(info.columns, whereColumn);
+    if (setIdx == -1 || whereIdx == -1)
+        return 0;
+    if (info.lsm)
+        return updateLsm(tableName, info, setIdx, setValue, whereIdx, whereValue);
+
+    // 有物化视图时收集更新前的记录，从视图中撤销旧值、加入新值
+    bool views = ViewManager::track(tableName);
+    vector<string> units = candidateUnits(tableName, info, whereIdx, whereValue);
+    if (setIdx != info.partitionIndex)
+    {
+        vector<vector<string>> before;
+        int count = 0;
+        for (const auto &base : units)
+        {
+            int updated = updateInUnit(base, info.types, setIdx, setValue, whereIdx, whereValue, views ? &before : nullptr);
+            if (updated > 0)
+                rebuildFilters(base, info);
+            count += updated;
+        }
+        for (auto &row : before)
+        {
+            ViewManager::onDelete(tableName, row);
+            row[setIdx] = setValue;
+            ViewManager::onInsert(tableName, row);
+        }
+        ViewManager::commit(tableName);
+        if (count > 0)
+            CacheManager::bumpVersion(tableName);
+        if (TableStats *stats = OptimizerManager::getStats(tableName))
+            stats->touchRows(count);
+        return count;
+    }
+
+    // 更新分区列时记录可能换到其他分区：先从原分区删除，再写入新值所在的分区
+    int target = PartitionManager::route(info.partition, setValue, info.partitionIsInt);
+    if (target < 0)
+        return 0;
+    vector<vector<string>> moved;
+    for (const auto &base : units)
+    {
+        if (deleteInUnit(base, info.types, whereIdx, whereValue, &moved) > 0)
+            rebuildFilters(base, info);
+    }
+    TableStats *stats = OptimizerManager::getStats(tableName);
+    if (stats)
+        stats->removeRows(moved.size());
+    if (views)
+    {
+        for (const auto &row : moved)
+            ViewManager::onDelete(tableName, row);
+    }
+    RowAppender appender(tableName, info);
+    for (auto &row : moved)
+    {
+        row[setIdx] = setValue;
+        appender.add(row);
+    }
+    appender.finish();
+    return static_cast<int>(moved.size());
+}
+
+// 导出表为CSV文件
+bool RecordManager::exportToCSV(const string &tableName, const string &filePath)
+{
+    // 读取字段名
+    TableInfo info = getTableInfo(tableName);
+    if (info.columns.empty())
+        return false;
+
+    // 按存储单元顺序流式读取记录，边读边交给写入器，不在内存中保留整张表
+    CsvExportWriter writer(filePath, info.columns);
+    if (!writer.isOpen())
+        return false;
+    scanTableBatches(tableName, info, [&](RowBatch &rows)
+                     { writer.add(rows); });
+    bool ok = writer.finish();
+    StatsManager::addBytesWritten(writer.bytesWritten());
+    return ok;
+}
+
+// 导出表为二进制列式文件
+bool RecordManager::exportToBinary(const string &tableName, const string &filePath)
+{
+    vector<pair<string, string>> columns = CatalogManager::getColumns(tableName);
+    if (columns.empty())
+        return false;
+
+    TableInfo info = getTableInfo(tableName);
+    BinaryExportWriter writer(filePath, columns);
+    if (!writer.isOpen())
+        return false;
+    scanTableBatches(tableName, info, [&](RowBatch &rows)
+                     { writer.add(rows); });
+    bool ok = writer.finish();
+    StatsManager::addBytesWritten(writer.bytesWritten());
+    return ok;
+}
+
+// 对表的每个存储单元分别压缩，返回压缩的记录总数
+int RecordManager::compactTable(const string &tableName)
+{
+    TableInfo info = getTableInfo(tableName);
+    if (info.types.empty())
+        return -1;
+    // LSM表把内存表和全部有序文件合并为一个
+    if (info.lsm)
+        return LsmManager::compact(tableName);
+    int total = 0;
+    for (const auto &base : allUnits(tableName, info))
+    {
+        int count = compactUnit(base, info.types);
+        if (count < 0)
+            return -1;
+        rebuildFilters(base, info);
+        total += count;
+    }
+    return total;
+}
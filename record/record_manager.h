@@ -1,6 +1,9 @@
 //record_manager.h - 记录管理器头文件
 
 #pragma once
+#include "../common/row_batch.h"
+#include "../optimizer/optimizer_manager.h"
+#include <functional>
 #include <string>
 #include <vector>
 using namespace std;
@@ -10,10 +13,32 @@ class RecordManager
 {
 public:
     static bool insertRecord(const string &tableName, const vector<string> &values);
-    static vector<vector<string>> selectAll(const string &tableName);
-    static vector<vector<string>> selectWhere(const string &tableName, const string &column, const string &value);
+    // 批量插入多行,返回插入的记录数,任一记录无法写入时不写入任何记录并返回-1
+    static int insertRecords(const string &tableName, const vector<vector<string>> &rows);
+    // INSERT INTO ... SELECT:把源表中满足whereColumn=whereValue(为空表示全部)的记录按projection写入目标表
+    static int insertSelect(const string &tableName, const string &sourceTable, const vector<int> &projection,
+                            const string &whereColumn, const string &whereValue);
+    // projection为要输出的列下标,为空时输出全部列;结果存放在一块连续缓冲区中
+    static RowBatch selectAll(const string &tableName, const vector<int> &projection = {});
+    static RowBatch selectWhere(const string &tableName, const string &column, const string &value,
+                                const vector<int> &projection = {});
+    // 逐行读取column=value(column为空表示全部)的记录,表或列不存在时返回false
+    static bool forEachRow(const string &tableName, const string &column, const string &value,
+                           const function<void(vector<string> &)> &onRow);
+    // 生成SELECT的扫描计划(EXPLAIN),column为空表示无条件,表或列不存在时返回false
+    static bool planSelect(const string &tableName, const string &column, const string &value, ScanPlan &plan);
+    // 收集表的统计信息(ANALYZE),返回统计的记录数,表不存在时返回-1
+    static int analyzeTable(const string &tableName);
+    // 在column列上建立Bloom过滤器,等值查询先用它排除一定不含该值的存储单元
+    static bool createBloomFilter(const string &tableName, const string &column);
     static int deleteWhere(const string &tableName, const string &column, const string &value);
+    // 删除RANGE分区及其数据,同时从依赖该表的物化视图和统计信息中去掉该分区的记录
+    static bool dropPartition(const string &tableName, int partitionId);
     static int updateWhere(const string &tableName, const string &setColumn, const string &setValue, const string &whereColumn, const string &whereValue);
     static bool exportToCSV(const string &tableName, const string &filePath);
+    // 导出为可直接内存映射的二进制列式文件,格式见export_writer.cpp
+    static bool exportToBinary(const string &tableName, const string &filePath);
+    // 将表中的记录按列压缩编码到data/<table>.seg,返回压缩的记录数,失败返回-1
+    static int compactTable(const string &tableName);
     static string trim(const string &s);
 };
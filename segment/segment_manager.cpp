@@ -0,0 +1,869 @@
+//segment_manager.cpp - 压缩段管理器实现
+
+#include "segment_manager.h"
+#include "../record/record_manager.h"
+#include "../stats/stats_manager.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <unordered_map>
+using namespace std;
+
+/*
+段文件格式(整数均为小端):
+  文件头: "MDBSEG1\n" + uint32列数
+  行组:   uint32行数 + 每列{uint8编码, uint32负载长度, 负载}
+行组依次排列直到文件结束
+*/
+namespace
+{
+    const char kMagic[8] = {'M', 'D', 'B', 'S', 'E', 'G', '1', '\n'};
+    constexpr size_t kRowGroupSize = 65536;
+
+    void putVarint(string &out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<char>(v));
+    }
+
+    size_t varintSize(uint64_t v)
+    {
+        size_t n = 1;
+        while (v >= 0x80)
+        {
+            v >>= 7;
+            ++n;
+        }
+        return n;
+    }
+
+    void putFixed(string &out, uint64_t v, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+
+    uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+    int bitWidth(uint64_t v)
+    {
+        int w = 0;
+        while (v)
+        {
+            ++w;
+            v >>= 1;
+        }
+        return w;
+    }
+
+    // 以width位为单位将vals紧密排列追加到out
+    void packBits(string &out, const vector<uint64_t> &vals, int width)
+    {
+        if (width == 0)
+            return;
+        size_t base = out.size();
+        out.resize(base + (vals.size() * width + 7) / 8, '\0');
+        size_t bit = 0;
+        for (uint64_t v : vals)
+        {
+            int written = 0;
+            while (written < width)
+            {
+                int offset = static_cast<int>(bit & 7);
+                int take = min(8 - offset, width - written);
+                uint64_t chunk = (v >> written) & ((1ULL << take) - 1);
+                char &byte = out[base + (bit >> 3)];
+                byte = static_cast<char>(static_cast<uint8_t>(byte) | (chunk << offset));
+                bit += take;
+                written += take;
+            }
+        }
+    }
+
+    // 取出位压缩数组中的第idx个值
+    uint64_t unpackBits(const uint8_t *p, size_t len, size_t idx, int width)
+    {
+        if (width == 0)
+            return 0;
+        size_t bit = idx * width;
+        size_t byte = bit >> 3;
+        int shift = static_cast<int>(bit & 7);
+        uint64_t word = 0;
+        for (int i = 0; i < 8 && byte + i < len; ++i)
+            word |= static_cast<uint64_t>(p[byte + i]) << (8 * i);
+        uint64_t v = word >> shift;
+        if (shift + width > 64 && byte + 8 < len)
+            v |= static_cast<uint64_t>(p[byte + 8]) << (64 - shift);
+        return width == 64 ? v : v & ((1ULL << width) - 1);
+    }
+
+    // 有边界检查的顺序读取器,数据损坏时置bad标志
+    struct ByteReader
+    {
+        const string &data;
+        size_t pos = 0;
+        bool bad = false;
+
+        explicit ByteReader(const string &d) : data(d) {}
+
+        uint8_t byte()
+        {
+            if (pos >= data.size())
+            {
+                bad = true;
+                return 0;
+            }
+            return static_cast<uint8_t>(data[pos++]);
+        }
+
+        uint64_t varint()
+        {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64 && !bad; shift += 7)
+            {
+                uint8_t b = byte();
+                v |= static_cast<uint64_t>(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+            bad = true;
+            return 0;
+        }
+
+        uint64_t fixed(int bytes)
+        {
+            uint64_t v = 0;
+            for (int i = 0; i < bytes; ++i)
+                v |= static_cast<uint64_t>(byte()) << (8 * i);
+            return v;
+        }
+
+        string bytes(uint64_t n)
+        {
+            if (n > data.size() - pos)
+            {
+                bad = true;
+                return string();
+            }
+            string s = data.substr(pos, n);
+            pos += n;
+            return s;
+        }
+
+        // 返回长度为count个width位值的位压缩区域并跳过它
+        const uint8_t *packed(uint64_t count, int width, size_t &len)
+        {
+            len = (count * width + 7) / 8;
+            if (width > 64 || len > data.size() - pos)
+            {
+                bad = true;
+                len = 0;
+                return nullptr;
+            }
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data()) + pos;
+            pos += len;
+            return p;
+        }
+    };
+
+    // 只有规范形式的整数(无前导零、无正号、无空格)才走整数编码,保证解码后与原文完全一致
+    bool parseCanonicalInt(const string &s, int64_t &out)
+    {
+        if (s.empty() || s.size() > 20)
+            return false;
+        errno = 0;
+        char *end = nullptr;
+        long long v = strtoll(s.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0' || to_string(v) != s)
+            return false;
+        out = v;
+        return true;
+    }
+
+    bool isIntType(string type)
+    {
+        transform(type.begin(), type.end(), type.begin(), ::tolower);
+        return type == "int";
+    }
+
+    // 整数列:比较参考帧、差分、游程三种编码的大小,取最小者
+    string encodeIntColumn(const vector<int64_t> &vals, ColumnEncoding &enc)
+    {
+        size_t n = vals.size();
+        int64_t mn = *min_element(vals.begin(), vals.end());
+        int64_t mx = *max_element(vals.begin(), vals.end());
+        uint64_t range = static_cast<uint64_t>(mx) - static_cast<uint64_t>(mn);
+
+        int forWidth = bitWidth(range);
+        size_t forSize = 9 + (n * forWidth + 7) / 8;
+
+        vector<pair<int64_t, uint64_t>> runs;
+        size_t rleSize = 0;
+        for (int64_t v : vals)
+        {
+            if (!runs.empty() && runs.back().first == v)
+            {
+                ++runs.back().second;
+                continue;
+            }
+            if (!runs.empty())
+                rleSize += varintSize(zigzag(runs.back().first)) + varintSize(runs.back().second);
+            runs.emplace_back(v, 1);
+        }
+        rleSize += varintSize(zigzag(runs.back().first)) + varintSize(runs.back().second) + varintSize(runs.size());
+
+        // 取值范围不超过int64时相邻差值不会溢出
+        bool deltaOk = range <= static_cast<uint64_t>(INT64_MAX);
+        int64_t minDelta = 0, maxDelta = 0;
+        if (deltaOk && n > 1)
+        {
+            minDelta = maxDelta = vals[1] - vals[0];
+            for (size_t i = 2; i < n; ++i)
+            {
+                int64_t d = vals[i] - vals[i - 1];
+                minDelta = min(minDelta, d);
+                maxDelta = max(maxDelta, d);
+            }
+        }
+        int deltaWidth = bitWidth(static_cast<uint64_t>(maxDelta) - static_cast<uint64_t>(minDelta));
+        size_t deltaSize = deltaOk ? 17 + ((n - 1) * deltaWidth + 7) / 8 : SIZE_MAX;
+
+        string out;
+        if (rleSize < forSize && rleSize <= deltaSize)
+        {
+            enc = ColumnEncoding::RLE;
+            putVarint(out, runs.size());
+            for (const auto &[value, length] : runs)
+            {
+                putVarint(out, zigzag(value));
+                putVarint(out, length);
+            }
+        }
+        else if (deltaSize < forSize)
+        {
+            enc = ColumnEncoding::DELTA;
+            putFixed(out, static_cast<uint64_t>(vals[0]), 8);
+            putFixed(out, static_cast<uint64_t>(minDelta), 8);
+            out.push_back(static_cast<char>(deltaWidth));
+            vector<uint64_t> packed;
+            packed.reserve(n - 1);
+            for (size_t i = 1; i < n; ++i)
+                packed.push_back(static_cast<uint64_t>(vals[i] - vals[i - 1]) - static_cast<uint64_t>(minDelta));
+            packBits(out, packed, deltaWidth);
+        }
+        else
+        {
+            enc = ColumnEncoding::FOR;
+            putFixed(out, static_cast<uint64_t>(mn), 8);
+            out.push_back(static_cast<char>(forWidth));
+            vector<uint64_t> packed;
+            packed.reserve(n);
+            for (int64_t v : vals)
+                packed.push_back(static_cast<uint64_t>(v) - static_cast<uint64_t>(mn));
+            packBits(out, packed, forWidth);
+        }
+        return out;
+    }
+
+    // 字符串列:不同值不超过行数一半时使用字典编码,再在位压缩与游程编码间取小者
+    string encodeStringColumn(const vector<string> &vals, ColumnEncoding &enc)
+    {
+        size_t n = vals.size();
+        size_t plainSize = 0;
+        for (const auto &v : vals)
+            plainSize += varintSize(v.size()) + v.size();
+
+        unordered_map<string, uint32_t> codes;
+        vector<const string *> dict;
+        vector<uint64_t> ids;
+        ids.reserve(n);
+        bool lowCardinality = true;
+        for (const auto &v : vals)
+        {
+            auto it = codes.find(v);
+            if (it == codes.end())
+            {
+                if ((dict.size() + 1) * 2 > n)
+                {
+                    lowCardinality = false;
+                    break;
+                }
+                it = codes.emplace(v, static_cast<uint32_t>(dict.size())).first;
+                dict.push_back(&it->first);
+            }
+            ids.push_back(it->second);
+        }
+
+        string out;
+        if (lowCardinality)
+        {
+            size_t dictSize = varintSize(dict.size());
+            for (const string *s : dict)
+                dictSize += varintSize(s->size()) + s->size();
+            int width = bitWidth(dict.size() - 1);
+            size_t packedSize = 1 + (n * width + 7) / 8;
+            size_t runCount = 0, rleSize = 0;
+            for (size_t i = 0; i < n;)
+            {
+                size_t j = i;
+                while (j < n && ids[j] == ids[i])
+                    ++j;
+                rleSize += varintSize(ids[i]) + varintSize(j - i);
+                ++runCount;
+                i = j;
+            }
+            rleSize += varintSize(runCount);
+
+            if (dictSize + min(packedSize, rleSize) < plainSize)
+            {
+                putVarint(out, dict.size());
+                for (const string *s : dict)
+                {
+                    putVarint(out, s->size());
+                    out += *s;
+                }
+                if (rleSize < packedSize)
+                {
+                    enc = ColumnEncoding::DICT_RLE;
+                    putVarint(out, runCount);
+                    for (size_t i = 0; i < n;)
+                    {
+                        size_t j = i;
+                        while (j < n && ids[j] == ids[i])
+                            ++j;
+                        putVarint(out, ids[i]);
+                        putVarint(out, j - i);
+                        i = j;
+                    }
+                }
+                else
+                {
+                    enc = ColumnEncoding::DICT;
+                    out.push_back(static_cast<char>(width));
+                    packBits(out, ids, width);
+                }
+                return out;
+            }
+        }
+
+        enc = ColumnEncoding::PLAIN;
+        for (const auto &v : vals)
+        {
+            putVarint(out, v.size());
+            out += v;
+        }
+        return out;
+    }
+
+    // 按升序行号挑选需要的行;rows为空指针时取全部
+    struct RowPicker
+    {
+        const vector<uint32_t> *rows;
+        size_t next = 0;
+
+        bool wants(uint32_t i)
+        {
+            if (!rows)
+                return true;
+            if (next < rows->size() && (*rows)[next] == i)
+            {
+                ++next;
+                return true;
+            }
+            return false;
+        }
+
+        bool done() const { return rows && next >= rows->size(); }
+    };
+
+    vector<string> readDictionary(ByteReader &r)
+    {
+        uint64_t size = r.varint();
+        vector<string> dict;
+        for (uint64_t i = 0; i < size && !r.bad; ++i)
+            dict.push_back(r.bytes(r.varint()));
+        return dict;
+    }
+
+    // 解码一列,rows非空时只输出这些行的值
+    bool decodeColumn(ColumnEncoding enc, const string &payload, uint32_t n, const vector<uint32_t> *rows, vector<string> &out)
+    {
+        ByteReader r(payload);
+        RowPicker pick{rows};
+        switch (enc)
+        {
+        case ColumnEncoding::PLAIN:
+            for (uint32_t i = 0; i < n && !r.bad && !pick.done(); ++i)
+            {
+                uint64_t len = r.varint();
+                if (pick.wants(i))
+                    out.push_back(r.bytes(len));
+                else if (len > payload.size() - r.pos)
+                    r.bad = true;
+                else
+                    r.pos += len;
+            }
+            break;
+        case ColumnEncoding::DICT:
+        {
+            vector<string> dict = readDictionary(r);
+            int width = r.byte();
+            size_t len = 0;
+            const uint8_t *p = r.packed(n, width, len);
+            for (uint32_t i = 0; i < n && !r.bad && !pick.done(); ++i)
+            {
+                if (!pick.wants(i))
+                    continue;
+                uint64_t code = unpackBits(p, len, i, width);
+                if (code >= dict.size())
+                    return false;
+                out.push_back(dict[code]);
+            }
+            break;
+        }
+        case ColumnEncoding::DICT_RLE:
+        {
+            vector<string> dict = readDictionary(r);
+            uint64_t runCount = r.varint();
+            uint32_t i = 0;
+            for (uint64_t k = 0; k < runCount && !r.bad && !pick.done(); ++k)
+            {
+                uint64_t code = r.varint();
+                uint64_t length = r.varint();
+                if (code >= dict.size() || length > n - i)
+                    return false;
+                for (uint64_t j = 0; j < length; ++j, ++i)
+                {
+                    if (pick.wants(i))
+                        out.push_back(dict[code]);
+                }
+            }
+            break;
+        }
+        case ColumnEncoding::FOR:
+        {
+            uint64_t base = r.fixed(8);
+            int width = r.byte();
+            size_t len = 0;
+            const uint8_t *p = r.packed(n, width, len);
+            for (uint32_t i = 0; i < n && !r.bad && !pick.done(); ++i)
+            {
+                if (pick.wants(i))
+                    out.push_back(to_string(static_cast<int64_t>(base + unpackBits(p, len, i, width))));
+            }
+            break;
+        }
+        case ColumnEncoding::DELTA:
+        {
+            uint64_t value = r.fixed(8);
+            uint64_t minDelta = r.fixed(8);
+            int width = r.byte();
+            size_t len = 0;
+            const uint8_t *p = r.packed(n - 1, width, len);
+            for (uint32_t i = 0; i < n && !r.bad && !pick.done(); ++i)
+            {
+                if (i > 0)
+                    value += unpackBits(p, len, i - 1, width) + minDelta;
+                if (pick.wants(i))
+                    out.push_back(to_string(static_cast<int64_t>(value)));
+            }
+            break;
+        }
+        case ColumnEncoding::RLE:
+        {
+            uint64_t runCount = r.varint();
+            uint32_t i = 0;
+            for (uint64_t k = 0; k < runCount && !r.bad && !pick.done(); ++k)
+            {
+                string value = to_string(unzigzag(r.varint()));
+                uint64_t length = r.varint();
+                if (length > n - i)
+                    return false;
+                for (uint64_t j = 0; j < length; ++j, ++i)
+                {
+                    if (pick.wants(i))
+                        out.push_back(value);
+                }
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+        return !r.bad;
+    }
+
+    // 在编码数据上求值等值条件,返回命中的行号
+    bool matchColumn(ColumnEncoding enc, const string &payload, uint32_t n, const string &target, vector<uint32_t> &hits)
+    {
+        ByteReader r(payload);
+        int64_t key = 0;
+        bool keyIsInt = parseCanonicalInt(target, key);
+        switch (enc)
+        {
+        case ColumnEncoding::PLAIN:
+            for (uint32_t i = 0; i < n && !r.bad; ++i)
+            {
+                if (RecordManager::trim(r.bytes(r.varint())) == target)
+                    hits.push_back(i);
+            }
+            break;
+        case ColumnEncoding::DICT:
+        case ColumnEncoding::DICT_RLE:
+        {
+            // 把目标值一次性解析为字典编码,之后只比较整数编码
+            vector<string> dict = readDictionary(r);
+            vector<bool> matches(dict.size(), false);
+            bool any = false;
+            for (size_t c = 0; c < dict.size(); ++c)
+            {
+                matches[c] = RecordManager::trim(dict[c]) == target;
+                any = any || matches[c];
+            }
+            if (!any)
+                break;
+            if (enc == ColumnEncoding::DICT)
+            {
+                int width = r.byte();
+                size_t len = 0;
+                const uint8_t *p = r.packed(n, width, len);
+                for (uint32_t i = 0; i < n && !r.bad; ++i)
+                {
+                    uint64_t code = unpackBits(p, len, i, width);
+                    if (code < matches.size() && matches[code])
+                        hits.push_back(i);
+                }
+            }
+            else
+            {
+                uint64_t runCount = r.varint();
+                uint32_t i = 0;
+                for (uint64_t k = 0; k < runCount && !r.bad; ++k)
+                {
+                    uint64_t code = r.varint();
+                    uint64_t length = r.varint();
+                    if (length > n - i)
+                        return false;
+                    if (code < matches.size() && matches[code])
+                    {
+                        for (uint64_t j = 0; j < length; ++j)
+                            hits.push_back(i + static_cast<uint32_t>(j));
+                    }
+                    i += static_cast<uint32_t>(length);
+                }
+            }
+            break;
+        }
+        case ColumnEncoding::FOR:
+        {
+            if (!keyIsInt)
+                break;
+            uint64_t base = r.fixed(8);
+            int width = r.byte();
+            size_t len = 0;
+            const uint8_t *p = r.packed(n, width, len);
+            uint64_t offset = static_cast<uint64_t>(key) - base;
+            if (static_cast<int64_t>(base) > key || (width < 64 && (offset >> width) != 0))
+                break;
+            for (uint32_t i = 0; i < n && !r.bad; ++i)
+            {
+                if (unpackBits(p, len, i, width) == offset)
+                    hits.push_back(i);
+            }
+            break;
+        }
+        case ColumnEncoding::DELTA:
+        {
+            if (!keyIsInt)
+                break;
+            uint64_t value = r.fixed(8);
+            uint64_t minDelta = r.fixed(8);
+            int width = r.byte();
+            size_t len = 0;
+            const uint8_t *p = r.packed(n - 1, width, len);
+            for (uint32_t i = 0; i < n && !r.bad; ++i)
+            {
+                if (i > 0)
+                    value += unpackBits(p, len, i - 1, width) + minDelta;
+                if (static_cast<int64_t>(value) == key)
+                    hits.push_back(i);
+            }
+            break;
+        }
+        case ColumnEncoding::RLE:
+        {
+            if (!keyIsInt)
+                break;
+            uint64_t runCount = r.varint();
+            uint32_t i = 0;
+            for (uint64_t k = 0; k < runCount && !r.bad; ++k)
+            {
+                int64_t value = unzigzag(r.varint());
+                uint64_t length = r.varint();
+                if (length > n - i)
+                    return false;
+                if (value == key)
+                {
+                    for (uint64_t j = 0; j < length; ++j)
+                        hits.push_back(i + static_cast<uint32_t>(j));
+                }
+                i += static_cast<uint32_t>(length);
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+        return !r.bad;
+    }
+
+    // 读取下一个行组的各列编码与负载,needed[c]为false的列直接跳过不读入内存;文件结束时返回false
+    bool readGroup(ifstream &fin, const vector<bool> &needed, uint32_t &rowCount,
+                   vector<ColumnEncoding> &encodings, vector<string> &payloads, uint64_t &bytesRead, bool &bad)
+    {
+        char head[4];
+        if (!fin.read(head, 4))
+            return false;
+        uint32_t columnCount = static_cast<uint32_t>(needed.size());
+        rowCount = static_cast<uint32_t>(ByteReader(string(head, 4)).fixed(4));
+        encodings.assign(columnCount, ColumnEncoding::PLAIN);
+        payloads.assign(columnCount, string());
+        bytesRead += 4;
+        for (uint32_t c = 0; c < columnCount; ++c)
+        {
+            char colHead[5];
+            if (!fin.read(colHead, 5))
+            {
+                bad = true;
+                return false;
+            }
+            string headBytes(colHead, 5);
+            ByteReader r(headBytes);
+            encodings[c] = static_cast<ColumnEncoding>(r.byte());
+            uint64_t len = r.fixed(4);
+            if (!needed[c])
+            {
+                fin.seekg(static_cast<streamoff>(len), ios::cur);
+                continue;
+            }
+            payloads[c].resize(len);
+            if (len > 0 && !fin.read(&payloads[c][0], len))
+            {
+                bad = true;
+                return false;
+            }
+            bytesRead += 5 + len;
+        }
+        return true;
+    }
+
+    // 输出列:columns为空时输出全部列,否则按columns的顺序输出;越界的列视为不存在
+    vector<int> outputColumns(uint32_t columnCount, const vector<int> &columns, vector<bool> &needed)
+    {
+        vector<int> output = columns;
+        if (output.empty())
+        {
+            for (uint32_t c = 0; c < columnCount; ++c)
+                output.push_back(static_cast<int>(c));
+        }
+        needed.assign(columnCount, false);
+        for (int c : output)
+        {
+            if (c >= 0 && static_cast<uint32_t>(c) < columnCount)
+                needed[c] = true;
+        }
+        return output;
+    }
+
+    // 把按列解码的值组装成行交给回调,rows为该行组中输出的行数
+    void emitRows(const vector<int> &output, vector<vector<string>> &decoded, size_t rows, const SegmentManager::RowCallback &onRow)
+    {
+        vector<string> row(output.size());
+        for (size_t i = 0; i < rows; ++i)
+        {
+            row.resize(output.size());
+            for (size_t k = 0; k < output.size(); ++k)
+            {
+                int c = output[k];
+                row[k] = c >= 0 && static_cast<size_t>(c) < decoded.size() && !decoded[c].empty() ? decoded[c][i] : string();
+            }
+            onRow(row);
+        }
+    }
+
+    bool openSegment(ifstream &fin, const string &filePath, uint32_t &columnCount)
+    {
+        fin.open(filePath, ios::binary);
+        if (!fin.is_open())
+            return false;
+        char head[12];
+        if (!fin.read(head, 12) || !equal(kMagic, kMagic + 8, head))
+            return false;
+        columnCount = static_cast<uint32_t>(ByteReader(string(head + 8, 4)).fixed(4));
+        return true;
+    }
+}
+
+SegmentWriter::SegmentWriter(const string &filePath, const vector<string> &columnTypes)
+    : fout(filePath, ios::binary | ios::trunc), types(columnTypes), columns(columnTypes.size())
+{
+    if (!fout.is_open())
+        return;
+    string head(kMagic, 8);
+    putFixed(head, types.size(), 4);
+    fout.write(head.data(), head.size());
+    bytes += head.size();
+}
+
+bool SegmentWriter::isOpen() const
+{
+    return fout.is_open();
+}
+
+void SegmentWriter::add(const vector<string> &row)
+{
+    if (columns.empty() || row.size() != columns.size())
+        return;
+    for (size_t c = 0; c < columns.size(); ++c)
+        columns[c].push_back(row[c]);
+    ++totalRows;
+    if (columns[0].size() >= kRowGroupSize)
+        flushGroup();
+}
+
+void SegmentWriter::flushGroup()
+{
+    if (columns.empty() || columns[0].empty())
+        return;
+    string group;
+    putFixed(group, columns[0].size(), 4);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        ColumnEncoding enc = ColumnEncoding::PLAIN;
+        string payload;
+        vector<int64_t> ints;
+        bool allInts = isIntType(types[c]);
+        if (allInts)
+        {
+            ints.reserve(columns[c].size());
+            for (const auto &v : columns[c])
+            {
+                int64_t x = 0;
+                if (!parseCanonicalInt(v, x))
+                {
+                    allInts = false;
+                    break;
+                }
+                ints.push_back(x);
+            }
+        }
+        payload = allInts ? encodeIntColumn(ints, enc) : encodeStringColumn(columns[c], enc);
+        group.push_back(static_cast<char>(enc));
+        putFixed(group, payload.size(), 4);
+        group += payload;
+        columns[c].clear();
+    }
+    fout.write(group.data(), group.size());
+    bytes += group.size();
+}
+
+bool SegmentWriter::finish()
+{
+    if (!fout.is_open())
+        return false;
+    flushGroup();
+    fout.close();
+    return !fout.fail();
+}
+
+bool SegmentManager::scan(const string &filePath, const RowCallback &onRow, const vector<int> &columns)
+{
+    ifstream fin;
+    uint32_t columnCount = 0;
+    if (!openSegment(fin, filePath, columnCount))
+        return false;
+
+    vector<bool> needed;
+    vector<int> output = outputColumns(columnCount, columns, needed);
+    uint64_t rowsRead = 0, bytesRead = 12;
+    uint32_t rowCount = 0;
+    vector<ColumnEncoding> encodings;
+    vector<string> payloads;
+    bool bad = false;
+    while (!bad && readGroup(fin, needed, rowCount, encodings, payloads, bytesRead, bad))
+    {
+        // 只解码输出需要的列
+        vector<vector<string>> decoded(columnCount);
+        for (uint32_t c = 0; c < columnCount && !bad; ++c)
+        {
+            if (!needed[c])
+                continue;
+            decoded[c].reserve(rowCount);
+            bad = !decodeColumn(encodings[c], payloads[c], rowCount, nullptr, decoded[c]) || decoded[c].size() != rowCount;
+        }
+        if (bad)
+            break;
+        emitRows(output, decoded, rowCount, onRow);
+        rowsRead += rowCount;
+    }
+    StatsManager::addRowsScanned(rowsRead);
+    StatsManager::addBytesRead(bytesRead);
+    return !bad;
+}
+
+bool SegmentManager::scanWhere(const string &filePath, int column, const string &value, const RowCallback &onRow,
+                               const vector<int> &columns)
+{
+    ifstream fin;
+    uint32_t columnCount = 0;
+    if (!openSegment(fin, filePath, columnCount))
+        return false;
+    if (column < 0 || static_cast<uint32_t>(column) >= columnCount)
+        return true;
+
+    vector<bool> needed;
+    vector<int> output = outputColumns(columnCount, columns, needed);
+    bool outputsFilter = needed[column];
+    needed[column] = true;
+
+    string target = RecordManager::trim(value);
+    uint64_t rowsRead = 0, bytesRead = 12;
+    uint32_t rowCount = 0;
+    vector<ColumnEncoding> encodings;
+    vector<string> payloads;
+    bool bad = false;
+    while (!bad && readGroup(fin, needed, rowCount, encodings, payloads, bytesRead, bad))
+    {
+        rowsRead += rowCount;
+        vector<uint32_t> hits;
+        if (!matchColumn(encodings[column], payloads[column], rowCount, target, hits))
+        {
+            bad = true;
+            break;
+        }
+        if (hits.empty())
+            continue;
+
+        // 只解码命中行的输出列
+        vector<vector<string>> decoded(columnCount);
+        for (uint32_t c = 0; c < columnCount && !bad; ++c)
+        {
+            if (!needed[c] || (static_cast<int>(c) == column && !outputsFilter))
+                continue;
+            decoded[c].reserve(hits.size());
+            bad = !decodeColumn(encodings[c], payloads[c], rowCount, &hits, decoded[c]) || decoded[c].size() != hits.size();
+        }
+        if (bad)
+            break;
+        emitRows(output, decoded, hits.size(), onRow);
+    }
+    StatsManager::addRowsScanned(rowsRead);
+    StatsManager::addBytesRead(bytesRead);
+    return !bad;
+}
@@ -0,0 +1,56 @@
+//segment_manager.h - 压缩段管理器头文件
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+using namespace std;
+
+// 列编码方式,写入时根据列类型和数据分布为每个行组的每一列单独选择
+enum class ColumnEncoding : uint8_t
+{
+    PLAIN,    // 原样存储的字符串
+    DICT,     // 字典编码,编码值按位压缩
+    DICT_RLE, // 字典编码,编码值再做游程编码
+    FOR,      // 参考帧(最小值)+位压缩的整数
+    DELTA,    // 差分+位压缩的整数,适合有序列
+    RLE       // 游程编码的整数,适合大量重复值
+};
+
+// 压缩段写入器,按行组累积记录,每满一组按列编码后写出,内存占用与表大小无关
+class SegmentWriter
+{
+public:
+    SegmentWriter(const string &filePath, const vector<string> &columnTypes);
+    bool isOpen() const;
+    // 追加一行,字段数必须与列数一致
+    void add(const vector<string> &row);
+    // 写出最后一个行组并关闭文件
+    bool finish();
+    uint64_t rowCount() const { return totalRows; }
+    uint64_t bytesWritten() const { return bytes; }
+
+private:
+    void flushGroup();
+
+    ofstream fout;
+    vector<string> types;
+    vector<vector<string>> columns; // 当前行组,按列存放
+    uint64_t totalRows = 0;
+    uint64_t bytes = 0;
+};
+
+// 压缩段读取,数据文件data/<table>.seg由COMPACT TABLE生成,.tbl文件作为其后的追加尾部
+class SegmentManager
+{
+public:
+    using RowCallback = function<void(vector<string> &row)>;
+
+    // 依次解码段中的所有记录;columns非空时只解码并按顺序输出这些列
+    static bool scan(const string &filePath, const RowCallback &onRow, const vector<int> &columns = {});
+    // 在编码数据上直接判断column列是否等于value,只解码命中的记录
+    static bool scanWhere(const string &filePath, int column, const string &value, const RowCallback &onRow,
+                          const vector<int> &columns = {});
+};
@@ -0,0 +1,409 @@
+//stats_manager.cpp - 运行统计管理器实现
+
+#include "stats_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+using namespace std;
+namespace fs = filesystem;
+
+namespace
+{
+    // 命令类型数量,UNKNOWN始终是枚举的最后一项
+    constexpr size_t kTypeCount = static_cast<size_t>(CommandType::UNKNOWN) + 1;
+
+    // HDR风格的对数-线性分桶:每个2的幂区间再细分为8个子桶,相对误差不超过12.5%
+    constexpr int kSubBits = 3;
+    constexpr uint64_t kSubCount = 1ULL << kSubBits;
+    constexpr size_t kBucketCount = 42 * kSubCount; // 覆盖到约2^42微秒
+
+    // 单个线程的统计分片,只由所属线程写入,读取方合并所有分片
+    struct Shard
+    {
+        atomic<uint64_t> count[kTypeCount]{};
+        atomic<uint64_t> errors[kTypeCount]{};
+        atomic<uint64_t> sumMicros[kTypeCount]{};
+        atomic<uint64_t> maxMicros[kTypeCount]{};
+        atomic<uint64_t> buckets[kTypeCount][kBucketCount]{};
+        atomic<uint64_t> rowsScanned{0};
+        atomic<uint64_t> deadRows{0};
+        atomic<uint64_t> bytesRead{0};
+        atomic<uint64_t> bytesWritten{0};
+        atomic<uint64_t> cacheHits{0};
+        atomic<uint64_t> cacheMisses{0};
+    };
+
+    // 分片注册表;线程退出时分片并入retired后释放,计数不丢失,分片数只与存活线程数有关
+    mutex registryMutex;
+    vector<unique_ptr<Shard>> shards;
+    Shard retired;
+
+    Shard *registerShard()
+    {
+        lock_guard<mutex> lock(registryMutex);
+        shards.push_back(make_unique<Shard>());
+        return shards.back().get();
+    }
+
+    void add(atomic<uint64_t> &to, const atomic<uint64_t> &from)
+    {
+        to.store(to.load(memory_order_relaxed) + from.load(memory_order_relaxed), memory_order_relaxed);
+    }
+
+    // 合并与注销在同一把锁内完成,读取方不会重复计数或漏计
+    void retireShard(Shard *shard)
+    {
+        lock_guard<mutex> lock(registryMutex);
+        for (size_t t = 0; t < kTypeCount; ++t)
+        {
+            add(retired.count[t], shard->count[t]);
+            add(retired.errors[t], shard->errors[t]);
+            add(retired.sumMicros[t], shard->sumMicros[t]);
+            if (shard->maxMicros[t].load(memory_order_relaxed) > retired.maxMicros[t].load(memory_order_relaxed))
+                retired.maxMicros[t].store(shard->maxMicros[t].load(memory_order_relaxed), memory_order_relaxed);
+            for (size_t b = 0; b < kBucketCount; ++b)
+                add(retired.buckets[t][b], shard->buckets[t][b]);
+        }
+        add(retired.rowsScanned, shard->rowsScanned);
+        add(retired.deadRows, shard->deadRows);
+        add(retired.bytesRead, shard->bytesRead);
+        add(retired.bytesWritten, shard->bytesWritten);
+        add(retired.cacheHits, shard->cacheHits);
+        add(retired.cacheMisses, shard->cacheMisses);
+        for (size_t i = 0; i < shards.size(); ++i)
+        {
+            if (shards[i].get() == shard)
+            {
+                shards[i] = move(shards.back());
+                shards.pop_back();
+                break;
+            }
+        }
+    }
+
+    // 线程第一次记录统计时注册分片,线程退出时注销
+    struct ShardHandle
+    {
+        Shard *shard = registerShard();
+        ~ShardHandle() { retireShard(shard); }
+    };
+
+    Shard &localShard()
+    {
+        thread_local ShardHandle handle;
+        return *handle.shard;
+    }
+
+    // 单写者计数器,无需原子读改写指令
+    inline void bump(atomic<uint64_t> &counter, uint64_t n)
+    {
+        counter.store(counter.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+
+    size_t bucketIndex(uint64_t v)
+    {
+        if (v < kSubCount)
+            return static_cast<size_t>(v);
+        int msb = 0;
+        while ((v >> (msb + 1)) != 0)
+            ++msb;
+        size_t idx = static_cast<size_t>(msb - kSubBits + 1) * kSubCount + ((v >> (msb - kSubBits)) & (kSubCount - 1));
+        return idx < kBucketCount ? idx : kBucketCount - 1;
+    }
+
+    // 桶内可能出现的最大值
+    uint64_t bucketUpper(size_t idx)
+    {
+        if (idx < kSubCount)
+            return idx;
+        int msb = static_cast<int>(idx / kSubCount) + kSubBits - 1;
+        uint64_t sub = idx % kSubCount;
+        return ((kSubCount + sub + 1) << (msb - kSubBits)) - 1;
+    }
+
+    // 合并后的快照
+    struct Snapshot
+    {
+        uint64_t count[kTypeCount] = {};
+        uint64_t errors[kTypeCount] = {};
+        uint64_t sumMicros[kTypeCount] = {};
+        uint64_t maxMicros[kTypeCount] = {};
+        vector<vector<uint64_t>> buckets = vector<vector<uint64_t>>(kTypeCount, vector<uint64_t>(kBucketCount, 0));
+        uint64_t rowsScanned = 0;
+        uint64_t deadRows = 0;
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t cacheHits = 0;
+        uint64_t cacheMisses = 0;
+    };
+
+    void addShard(Snapshot &snap, const Shard &shard)
+    {
+        for (size_t t = 0; t < kTypeCount; ++t)
+        {
+            snap.count[t] += shard.count[t].load(memory_order_relaxed);
+            snap.errors[t] += shard.errors[t].load(memory_order_relaxed);
+            snap.sumMicros[t] += shard.sumMicros[t].load(memory_order_relaxed);
+            snap.maxMicros[t] = max(snap.maxMicros[t], shard.maxMicros[t].load(memory_order_relaxed));
+            for (size_t b = 0; b < kBucketCount; ++b)
+                snap.buckets[t][b] += shard.buckets[t][b].load(memory_order_relaxed);
+        }
+        snap.rowsScanned += shard.rowsScanned.load(memory_order_relaxed);
+        snap.deadRows += shard.deadRows.load(memory_order_relaxed);
+        snap.bytesRead += shard.bytesRead.load(memory_order_relaxed);
+        snap.bytesWritten += shard.bytesWritten.load(memory_order_relaxed);
+        snap.cacheHits += shard.cacheHits.load(memory_order_relaxed);
+        snap.cacheMisses += shard.cacheMisses.load(memory_order_relaxed);
+    }
+
+    Snapshot takeSnapshot()
+    {
+        Snapshot snap;
+        lock_guard<mutex> lock(registryMutex);
+        addShard(snap, retired);
+        for (const auto &shard : shards)
+            addShard(snap, *shard);
+        return snap;
+    }
+
+    // 根据直方图估算分位数(微秒)
+    uint64_t percentile(const Snapshot &snap, size_t type, double q)
+    {
+        uint64_t total = snap.count[type];
+        if (total == 0)
+            return 0;
+        uint64_t target = static_cast<uint64_t>(ceil(q * total));
+        if (target == 0)
+            target = 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBucketCount; ++b)
+        {
+            seen += snap.buckets[type][b];
+            if (seen >= target)
+                return min(bucketUpper(b), snap.maxMicros[type]);
+        }
+        return snap.maxMicros[type];
+    }
+
+    double fraction(uint64_t part, uint64_t total)
+    {
+        return total == 0 ? 0.0 : static_cast<double>(part) / total;
+    }
+
+    string commandName(size_t type)
+    {
+        switch (static_cast<CommandType>(type))
+        {
+        case CommandType::CREATE:
+            return "create";
+        case CommandType::INSERT:
+            return "insert";
+        case CommandType::SELECT:
+            return "select";
+        case CommandType::DELETE:
+            return "delete";
+        case CommandType::UPDATE:
+            return "update";
+        case CommandType::DROP:
+            return "drop";
+        case CommandType::EXPORT:
+            return "export";
+        case CommandType::SHOW_STATS:
+            return "show_stats";
+        case CommandType::COMPACT:
+            return "compact";
+        case CommandType::DROP_PARTITION:
+            return "drop_partition";
+        case CommandType::ANALYZE:
+            return "analyze";
+        case CommandType::EXPLAIN:
+            return "explain";
+        case CommandType::CREATE_BLOOM:
+            return "create_bloom";
+        case CommandType::CREATE_VIEW:
+            return "create_view";
+        case CommandType::REFRESH_VIEW:
+            return "refresh_view";
+        default:
+            return "unknown";
+        }
+    }
+
+    // 后台导出线程状态
+    mutex dumpMutex;
+    condition_variable dumpCv;
+    thread dumpThread;
+    bool dumpStopping = false;
+}
+
+void StatsManager::recordCommand(CommandType type, uint64_t micros, bool ok)
+{
+    size_t t = static_cast<size_t>(type);
+    if (t >= kTypeCount)
+        t = kTypeCount - 1;
+    Shard &shard = localShard();
+    bump(shard.count[t], 1);
+    if (!ok)
+        bump(shard.errors[t], 1);
+    bump(shard.sumMicros[t], micros);
+    if (micros > shard.maxMicros[t].load(memory_order_relaxed))
+        shard.maxMicros[t].store(micros, memory_order_relaxed);
+    bump(shard.buckets[t][bucketIndex(micros)], 1);
+}
+
+void StatsManager::addRowsScanned(uint64_t n) { bump(localShard().rowsScanned, n); }
+void StatsManager::addDeadRows(uint64_t n) { bump(localShard().deadRows, n); }
+void StatsManager::addBytesRead(uint64_t n) { bump(localShard().bytesRead, n); }
+void StatsManager::addBytesWritten(uint64_t n) { bump(localShard().bytesWritten, n); }
+void StatsManager::addCacheHit() { bump(localShard().cacheHits, 1); }
+void StatsManager::addCacheMiss() { bump(localShard().cacheMisses, 1); }
+
+string StatsManager::report()
+{
+    Snapshot snap = takeSnapshot();
+    // 命令列宽度按最长的命令名确定,至少留两个空格
+    size_t nameWidth = string("Command").size();
+    for (size_t t = 0; t < kTypeCount; ++t)
+        nameWidth = max(nameWidth, commandName(t).size());
+    int width = static_cast<int>(nameWidth) + 2;
+    ostringstream out;
+    out << fixed << setprecision(3);
+    out << left << setw(width) << "Command" << right << setw(10) << "Count" << setw(8) << "Errors"
+        << setw(12) << "Avg(ms)" << setw(12) << "p50(ms)" << setw(12) << "p95(ms)"
+        << setw(12) << "p99(ms)" << setw(12) << "Max(ms)" << "\n";
+    for (size_t t = 0; t < kTypeCount; ++t)
+    {
+        if (snap.count[t] == 0)
+            continue;
+        out << left << setw(width) << commandName(t) << right << setw(10) << snap.count[t] << setw(8) << snap.errors[t]
+            << setw(12) << snap.sumMicros[t] / 1000.0 / snap.count[t]
+            << setw(12) << percentile(snap, t, 0.50) / 1000.0
+            << setw(12) << percentile(snap, t, 0.95) / 1000.0
+            << setw(12) << percentile(snap, t, 0.99) / 1000.0
+            << setw(12) << snap.maxMicros[t] / 1000.0 << "\n";
+    }
+    out << "Rows scanned:    " << snap.rowsScanned << "\n";
+    out << "Dead rows seen:  " << snap.deadRows << " (ratio "
+        << fraction(snap.deadRows, snap.rowsScanned + snap.deadRows) << ")\n";
+    out << "Bytes read:      " << snap.bytesRead << "\n";
+    out << "Bytes written:   " << snap.bytesWritten << "\n";
+    out << "Cache hit rate:  " << fraction(snap.cacheHits, snap.cacheHits + snap.cacheMisses)
+        << " (" << snap.cacheHits << " hits, " << snap.cacheMisses << " misses)\n";
+    return out.str();
+}
+
+string StatsManager::prometheusText()
+{
+    Snapshot snap = takeSnapshot();
+    ostringstream out;
+    out << setprecision(9);
+
+    out << "# HELP minidb_commands_total Number of executed commands.\n";
+    out << "# TYPE minidb_commands_total counter\n";
+    for (size_t t = 0; t < kTypeCount; ++t)
+        out << "minidb_commands_total{command=\"" << commandName(t) << "\"} " << snap.count[t] << "\n";
+
+    out << "# HELP minidb_command_errors_total Number of failed commands.\n";
+    out << "# TYPE minidb_command_errors_total counter\n";
+    for (size_t t = 0; t < kTypeCount; ++t)
+        out << "minidb_command_errors_total{command=\"" << commandName(t) << "\"} " << snap.errors[t] << "\n";
+
+    out << "# HELP minidb_command_latency_seconds Command latency.\n";
+    out << "# TYPE minidb_command_latency_seconds summary\n";
+    const double quantiles[] = {0.5, 0.9, 0.95, 0.99, 0.999};
+    for (size_t t = 0; t < kTypeCount; ++t)
+    {
+        string name = commandName(t);
+        for (double q : quantiles)
+        {
+            out << "minidb_command_latency_seconds{command=\"" << name << "\",quantile=\"" << q << "\"} "
+                << percentile(snap, t, q) / 1e6 << "\n";
+        }
+        out << "minidb_command_latency_seconds_sum{command=\"" << name << "\"} " << snap.sumMicros[t] / 1e6 << "\n";
+        out << "minidb_command_latency_seconds_count{command=\"" << name << "\"} " << snap.count[t] << "\n";
+    }
+
+    auto counter = [&](const string &name, const string &help, uint64_t value)
+    {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " counter\n";
+        out << name << " " << value << "\n";
+    };
+    auto gauge = [&](const string &name, const string &help, double value)
+    {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " gauge\n";
+        out << name << " " << value << "\n";
+    };
+    counter("minidb_rows_scanned_total", "Live rows visited by scans.", snap.rowsScanned);
+    counter("minidb_dead_rows_total", "Deleted rows skipped by scans.", snap.deadRows);
+    counter("minidb_bytes_read_total", "Bytes read from table files.", snap.bytesRead);
+    counter("minidb_bytes_written_total", "Bytes written to table and export files.", snap.bytesWritten);
+    counter("minidb_cache_hits_total", "Cache hits.", snap.cacheHits);
+    counter("minidb_cache_misses_total", "Cache misses.", snap.cacheMisses);
+    gauge("minidb_dead_row_ratio", "Fraction of scanned rows that were deleted.",
+          fraction(snap.deadRows, snap.rowsScanned + snap.deadRows));
+    gauge("minidb_cache_hit_ratio", "Fraction of cache lookups that hit.",
+          fraction(snap.cacheHits, snap.cacheHits + snap.cacheMisses));
+    return out.str();
+}
+
+bool StatsManager::dumpToFile(const string &filePath)
+{
+    // 先写临时文件再重命名,采集方不会读到写了一半的文件
+    string tmpPath = filePath + ".tmp";
+    {
+        ofstream fout(tmpPath, ios::trunc);
+        if (!fout.is_open())
+            return false;
+        fout << prometheusText();
+        if (!fout)
+            return false;
+    }
+    error_code ec;
+    fs::rename(tmpPath, filePath, ec);
+    return !ec;
+}
+
+void StatsManager::startPeriodicDump(const string &filePath, unsigned intervalSeconds)
+{
+    stopPeriodicDump();
+    if (intervalSeconds == 0)
+        intervalSeconds = 1;
+    dumpStopping = false;
+    dumpThread = thread([filePath, intervalSeconds]()
+                        {
+        unique_lock<mutex> lock(dumpMutex);
+        while (!dumpCv.wait_for(lock, chrono::seconds(intervalSeconds), [] { return dumpStopping; }))
+        {
+            lock.unlock();
+            dumpToFile(filePath);
+            lock.lock();
+        }
+        lock.unlock();
+        // 退出前再导出一次,保留最终状态
+        dumpToFile(filePath); });
+}
+
+void StatsManager::stopPeriodicDump()
+{
+    if (!dumpThread.joinable())
+        return;
+    {
+        lock_guard<mutex> lock(dumpMutex);
+        dumpStopping = true;
+    }
+    dumpCv.notify_all();
+    dumpThread.join();
+}
@@ -0,0 +1,34 @@
+//stats_manager.h - 运行统计管理器头文件
+
+#pragma once
+#include "../common/command.h"
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// 运行统计管理器,按命令类型记录执行次数与延迟直方图,并汇总引擎级计数器
+// 每个线程写入自己的分片,读取时再合并,写路径上没有锁竞争
+class StatsManager
+{
+public:
+    // 记录一次命令执行的耗时(微秒)及是否成功
+    static void recordCommand(CommandType type, uint64_t micros, bool ok);
+
+    // 引擎计数器
+    static void addRowsScanned(uint64_t n);
+    static void addDeadRows(uint64_t n);
+    static void addBytesRead(uint64_t n);
+    static void addBytesWritten(uint64_t n);
+    static void addCacheHit();
+    static void addCacheMiss();
+
+    // 生成SHOW STATS的文本报告
+    static string report();
+    // 生成Prometheus文本格式的指标
+    static string prometheusText();
+    // 将Prometheus格式指标写入文件(先写临时文件再重命名)
+    static bool dumpToFile(const string &filePath);
+    // 启动/停止后台线程,按固定间隔(秒)导出指标
+    static void startPeriodicDump(const string &filePath, unsigned intervalSeconds);
+    static void stopPeriodicDump();
+};
@@ -0,0 +1,558 @@
+//view_manager.cpp - 聚合查询与物化视图实现
+
+#include "view_manager.h"
+#include "../cache/cache_manager.h"
+#include "../catalog/catalog_manager.h"
+#include "../parser/parser.h"
+#include "../record/record_manager.h"
+#include "../stats/stats_manager.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+using namespace std;
+namespace fs = filesystem;
+
+namespace
+{
+    string lowered(string s)
+    {
+        transform(s.begin(), s.end(), s.begin(), ::tolower);
+        return s;
+    }
+
+    // 空字段和NULL视为空值,与统计信息的口径一致
+    bool isNull(const string &v)
+    {
+        return v.empty() || lowered(v) == "null";
+    }
+
+    bool parseInt(const string &s, long long &out)
+    {
+        if (s.empty())
+            return false;
+        errno = 0;
+        char *end = nullptr;
+        out = strtoll(s.c_str(), &end, 10);
+        return errno == 0 && *end == '\0';
+    }
+
+    // 拆分SELECT列表中的一项,如"region"、"COUNT(*)"、"SUM(amount) AS total";function为空表示普通列
+    bool parseItem(const string &item, string &function, string &argument, string &alias)
+    {
+        string text = RecordManager::trim(item);
+        size_t asPos = lowered(text).rfind(" as ");
+        alias.clear();
+        if (asPos != string::npos)
+        {
+            alias = RecordManager::trim(text.substr(asPos + 4));
+            text = RecordManager::trim(text.substr(0, asPos));
+            if (alias.empty() || any_of(alias.begin(), alias.end(), ::isspace))
+                return false;
+        }
+        size_t open = text.find('(');
+        if (open == string::npos)
+        {
+            function.clear();
+            argument = text;
+            return !text.empty();
+        }
+        if (text.back() != ')')
+            return false;
+        function = lowered(RecordManager::trim(text.substr(0, open)));
+        argument = RecordManager::trim(text.substr(open + 1, text.size() - open - 2));
+        return function == "count" || function == "sum" || function == "avg";
+    }
+
+    // 先写临时文件再重命名,避免中途退出留下半个文件
+    bool replaceFile(const string &filePath, const string &content)
+    {
+        string tmp = filePath + ".tmp";
+        {
+            ofstream fout(tmp, ios::trunc);
+            if (!fout.write(content.data(), content.size()))
+                return false;
+        }
+        error_code ec;
+        fs::rename(tmp, filePath, ec);
+        if (!ec)
+            StatsManager::addBytesWritten(content.size());
+        return !ec;
+    }
+
+    // 已载入的物化视图
+    struct MaterializedView
+    {
+        string name;
+        string source;      // 基表
+        string whereColumn; // 定义中的WHERE条件,为空表示全表
+        string whereValue;
+        int whereIndex = -1;
+        GroupAggregator aggregator;
+        bool dirty = false;
+    };
+
+    map<string, unique_ptr<MaterializedView>> views;
+    map<string, vector<MaterializedView *>> bySource; // 基表 -> 依赖它的物化视图,track时建立
+
+    // 视图的结果按普通表存放在data/<view>.tbl,各分组的中间状态存放在data/<view>.mv
+    string statePath(const string &viewName)
+    {
+        return "data/" + viewName + ".mv";
+    }
+
+    // 解析视图定义
+    bool define(MaterializedView &view, const string &query)
+    {
+        auto cmd = Parser::parse(query);
+        if (cmd->type != CommandType::SELECT)
+            return false;
+        auto select = static_cast<SelectCommand *>(cmd.get());
+        auto columns = CatalogManager::getColumns(select->tableName);
+        if (!view.aggregator.init(columns, select->columns, select->groupBy))
+            return false;
+        view.source = select->tableName;
+        if (select->condition.empty())
+            return true;
+        size_t eq = select->condition.find('=');
+        if (eq == string::npos)
+            return false;
+        view.whereColumn = RecordManager::trim(select->condition.substr(0, eq));
+        view.whereValue = RecordManager::trim(select->condition.substr(eq + 1));
+        if (view.whereValue.size() >= 2 && view.whereValue.front() == '"' && view.whereValue.back() == '"')
+            view.whereValue = view.whereValue.substr(1, view.whereValue.size() - 2);
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            if (columns[i].first == view.whereColumn)
+                view.whereIndex = static_cast<int>(i);
+        }
+        return view.whereIndex >= 0;
+    }
+
+    bool matches(const MaterializedView &view, const vector<string> &row)
+    {
+        return view.whereIndex < 0 ||
+               (row.size() > static_cast<size_t>(view.whereIndex) && RecordManager::trim(row[view.whereIndex]) == view.whereValue);
+    }
+
+    // 扫描基表从头计算
+    void recompute(MaterializedView &view)
+    {
+        view.aggregator.clear();
+        RecordManager::forEachRow(view.source, view.whereColumn, view.whereValue, [&](vector<string> &row)
+                                  { view.aggregator.add(row); });
+    }
+
+    // 写回中间状态和结果表,结果只与分组数有关,与基表大小无关
+    bool save(MaterializedView &view)
+    {
+        string content;
+        RowBatch rows = view.aggregator.rows();
+        for (size_t r = 0; r < rows.size(); ++r)
+        {
+            for (size_t i = 0; i < rows.fieldCount(r); ++i)
+            {
+                if (i > 0)
+                    content.push_back(',');
+                content += rows.field(r, i);
+            }
+            content.push_back('\n');
+        }
+        fs::create_directory("data");
+        bool ok = view.aggregator.save(statePath(view.name)) && replaceFile("data/" + view.name + ".tbl", content);
+        view.dirty = !ok;
+        CacheManager::bumpVersion(view.name);
+        return ok;
+    }
+
+    MaterializedView *load(const string &viewName)
+    {
+        auto it = views.find(viewName);
+        if (it != views.end())
+            return it->second.get();
+        string source, query;
+        if (!CatalogManager::getViewDefinition(viewName, source, query))
+            return nullptr;
+        auto view = make_unique<MaterializedView>();
+        view->name = viewName;
+        if (!define(*view, query))
+            return nullptr;
+        // 状态文件缺失或与定义不符时扫描基表重新计算
+        if (!view->aggregator.load(statePath(viewName)))
+        {
+            recompute(*view);
+            save(*view);
+        }
+        return views.emplace(viewName, move(view)).first->second.get();
+    }
+}
+
+bool GroupAggregator::init(const vector<pair<string, string>> &tableColumns, const vector<string> &select,
+                           const vector<string> &groupBy)
+{
+    keyColumns.clear();
+    numericKeys.clear();
+    outputs.clear();
+    inputs.clear();
+    groups.clear();
+    auto indexOf = [&](const string &name)
+    {
+        for (size_t i = 0; i < tableColumns.size(); ++i)
+        {
+            if (tableColumns[i].first == name)
+                return static_cast<int>(i);
+        }
+        return -1;
+    };
+
+    for (const auto &name : groupBy)
+    {
+        int index = indexOf(name);
+        if (index < 0)
+            return false;
+        keyColumns.push_back(index);
+        numericKeys.push_back(tableColumns[index].second == "int");
+    }
+
+    // SELECT *不能用于聚合,普通列必须出现在GROUP BY中,SUM和AVG只用于int列
+    if (select.empty())
+        return false;
+    for (const auto &item : select)
+    {
+        string function, argument, alias;
+        if (!parseItem(item, function, argument, alias))
+            return false;
+        Output out;
+        out.function = function;
+        if (function.empty())
+        {
+            int index = indexOf(argument);
+            auto pos = find(keyColumns.begin(), keyColumns.end(), index);
+            if (index < 0 || pos == keyColumns.end())
+                return false;
+            out.column = static_cast<int>(pos - keyColumns.begin());
+            out.name = argument;
+            out.type = tableColumns[index].second;
+        }
+        else
+        {
+            Input input;
+            if (argument != "*")
+            {
+                input.column = indexOf(argument);
+                if (input.column < 0)
+                    return false;
+            }
+            else if (function != "count")
+            {
+                return false;
+            }
+            input.numeric = function != "count";
+            if (input.numeric && tableColumns[input.column].second != "int")
+                return false;
+            out.column = static_cast<int>(inputs.size());
+            inputs.push_back(input);
+            out.name = input.column < 0 ? function : function + "_" + argument;
+            out.type = function == "avg" ? "float" : "int";
+        }
+        if (!alias.empty())
+            out.name = alias;
+        bool duplicate = any_of(outputs.begin(), outputs.end(), [&](const Output &o)
+                                { return o.name == out.name; });
+        if (duplicate)
+            return false;
+        outputs.push_back(out);
+    }
+    return true;
+}
+
+void GroupAggregator::apply(const vector<string> &row, int sign)
+{
+    vector<string> key;
+    key.reserve(keyColumns.size());
+    for (int index : keyColumns)
+        key.push_back(static_cast<size_t>(index) < row.size() ? RecordManager::trim(row[index]) : "");
+    auto it = groups.find(key);
+    if (it == groups.end())
+    {
+        if (sign < 0)
+            return;
+        Group group;
+        group.counts.assign(inputs.size(), 0);
+        group.sums.assign(inputs.size(), 0);
+        it = groups.emplace(move(key), move(group)).first;
+    }
+
+    Group &group = it->second;
+    group.rows += sign;
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        if (inputs[i].column < 0)
+        {
+            group.counts[i] += sign;
+            continue;
+        }
+        string v = static_cast<size_t>(inputs[i].column) < row.size() ? RecordManager::trim(row[inputs[i].column]) : "";
+        if (isNull(v))
+            continue;
+        long long x = 0;
+        if (!inputs[i].numeric)
+            group.counts[i] += sign;
+        else if (parseInt(v, x))
+        {
+            group.counts[i] += sign;
+            group.sums[i] += sign * x;
+        }
+    }
+    // 分组的记录全部删除后该分组不再出现在结果中
+    if (group.rows <= 0)
+        groups.erase(it);
+}
+
+void GroupAggregator::add(const vector<string> &row)
+{
+    apply(row, 1);
+}
+
+void GroupAggregator::remove(const vector<string> &row)
+{
+    apply(row, -1);
+}
+
+vector<pair<string, string>> GroupAggregator::columns() const
+{
+    vector<pair<string, string>> result;
+    for (const auto &out : outputs)
+        result.emplace_back(out.name, out.type);
+    return result;
+}
+
+RowBatch GroupAggregator::rows() const
+{
+    // 没有GROUP BY时即使没有记录也输出一行
+    vector<pair<const vector<string> *, const Group *>> ordered;
+    Group empty;
+    empty.counts.assign(inputs.size(), 0);
+    empty.sums.assign(inputs.size(), 0);
+    vector<string> noKey;
+    for (const auto &[key, group] : groups)
+        ordered.emplace_back(&key, &group);
+    if (keyColumns.empty() && ordered.empty())
+        ordered.emplace_back(&noKey, &empty);
+
+    // int分组列按数值排序
+    stable_sort(ordered.begin(), ordered.end(), [&](const auto &a, const auto &b)
+                {
+        for (size_t i = 0; i < keyColumns.size(); ++i)
+        {
+            const string &x = (*a.first)[i], &y = (*b.first)[i];
+            if (x == y)
+                continue;
+            long long p = 0, q = 0;
+            if (numericKeys[i] && parseInt(x, p) && parseInt(y, q))
+                return p < q;
+            return x < y;
+        }
+        return false; });
+
+    RowBatch result;
+    for (const auto &[key, group] : ordered)
+    {
+        for (const auto &out : outputs)
+        {
+            if (out.function.empty())
+                result.addField((*key)[out.column]);
+            else if (out.function == "count")
+                result.addField(to_string(group->counts[out.column]));
+            else if (group->counts[out.column] == 0)
+                result.addField("NULL");
+            else if (out.function == "sum")
+                result.addField(to_string(group->sums[out.column]));
+            else
+            {
+                ostringstream avg;
+                avg << static_cast<double>(group->sums[out.column]) / group->counts[out.column];
+                result.addField(avg.str());
+            }
+        }
+        result.endRow();
+    }
+    return result;
+}
+
+/*
+状态文件格式(文本):
+  "MDBMV1 <分组列数> <聚合列数>"
+  之后每个分组一行,以制表符分隔:各分组值、行数、每个聚合列的非空值个数与和
+*/
+bool GroupAggregator::save(const string &filePath) const
+{
+    ostringstream out;
+    out << "MDBMV1 " << keyColumns.size() << " " << inputs.size() << "\n";
+    for (const auto &[key, group] : groups)
+    {
+        for (const auto &value : key)
+            out << value << "\t";
+        out << group.rows;
+        for (size_t i = 0; i < inputs.size(); ++i)
+            out << "\t" << group.counts[i] << "\t" << group.sums[i];
+        out << "\n";
+    }
+    return replaceFile(filePath, out.str());
+}
+
+bool GroupAggregator::load(const string &filePath)
+{
+    ifstream fin(filePath);
+    string magic;
+    size_t keys = 0, aggregates = 0;
+    if (!(fin >> magic >> keys >> aggregates) || magic != "MDBMV1" || keys != keyColumns.size() ||
+        aggregates != inputs.size())
+        return false;
+    fin.ignore(1);
+
+    map<vector<string>, Group> loaded;
+    string line;
+    while (getline(fin, line))
+    {
+        vector<string> fields;
+        stringstream ss(line);
+        string field;
+        while (getline(ss, field, '\t'))
+            fields.push_back(field);
+        if (fields.size() != keys + 1 + 2 * aggregates)
+            return false;
+        Group group;
+        long long v = 0;
+        if (!parseInt(fields[keys], v))
+            return false;
+        group.rows = v;
+        for (size_t i = 0; i < aggregates; ++i)
+        {
+            long long count = 0, sum = 0;
+            if (!parseInt(fields[keys + 1 + 2 * i], count) || !parseInt(fields[keys + 2 + 2 * i], sum))
+                return false;
+            group.counts.push_back(count);
+            group.sums.push_back(sum);
+        }
+        fields.resize(keys);
+        loaded.emplace(move(fields), move(group));
+    }
+    groups = move(loaded);
+    return true;
+}
+
+bool GroupAggregator::isAggregate(const vector<string> &select)
+{
+    return any_of(select.begin(), select.end(), [](const string &item)
+                  { return item.find('(') != string::npos; });
+}
+
+bool ViewManager::createView(const string &viewName, const string &query)
+{
+    auto view = make_unique<MaterializedView>();
+    view->name = viewName;
+    if (!define(*view, query))
+        return false;
+    if (!CatalogManager::createView(viewName, view->aggregator.columns(), view->source, query))
+        return false;
+    recompute(*view);
+    if (!save(*view))
+        return false;
+    // 基表的视图列表已变化,下次写入时重新建立
+    bySource.erase(view->source);
+    views[viewName] = move(view);
+    return true;
+}
+
+void ViewManager::dropView(const string &viewName)
+{
+    string source, query;
+    if (!CatalogManager::getViewDefinition(viewName, source, query))
+        return;
+    bySource.erase(source);
+    views.erase(viewName);
+    fs::remove(statePath(viewName));
+}
+
+bool ViewManager::refreshView(const string &viewName)
+{
+    MaterializedView *view = load(viewName);
+    if (!view)
+        return false;
+    recompute(*view);
+    return save(*view);
+}
+
+bool ViewManager::track(const string &tableName)
+{
+    auto it = bySource.find(tableName);
+    if (it == bySource.end())
+    {
+        vector<MaterializedView *> list;
+        for (const auto &name : CatalogManager::getViews(tableName))
+        {
+            if (MaterializedView *view = load(name))
+                list.push_back(view);
+        }
+        it = bySource.emplace(tableName, move(list)).first;
+    }
+    return !it->second.empty();
+}
+
+void ViewManager::onInsert(const string &tableName, const vector<string> &row)
+{
+    auto it = bySource.find(tableName);
+    if (it == bySource.end())
+        return;
+    for (MaterializedView *view : it->second)
+    {
+        if (!matches(*view, row))
+            continue;
+        view->aggregator.add(row);
+        view->dirty = true;
+    }
+}
+
+void ViewManager::onDelete(const string &tableName, const vector<string> &row)
+{
+    auto it = bySource.find(tableName);
+    if (it == bySource.end())
+        return;
+    for (MaterializedView *view : it->second)
+    {
+        if (!matches(*view, row))
+            continue;
+        view->aggregator.remove(row);
+        view->dirty = true;
+    }
+}
+
+void ViewManager::commit(const string &tableName)
+{
+    auto it = bySource.find(tableName);
+    if (it == bySource.end())
+        return;
+    for (MaterializedView *view : it->second)
+    {
+        if (view->dirty)
+            save(*view);
+    }
+}
+
+bool ViewManager::aggregate(const string &tableName, const vector<string> &select, const vector<string> &groupBy,
+                            const string &whereColumn, const string &whereValue, RowBatch &rows)
+{
+    GroupAggregator aggregator;
+    if (!aggregator.init(CatalogManager::getColumns(tableName), select, groupBy))
+        return false;
+    bool ok = RecordManager::forEachRow(tableName, whereColumn, whereValue, [&](vector<string> &row)
+                                        { aggregator.add(row); });
+    if (ok)
+        rows = aggregator.rows();
+    return ok;
+}
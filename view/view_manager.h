@@ -0,0 +1,82 @@
+//view_manager.h - 聚合查询与物化视图头文件
+
+#pragma once
+#include "../common/row_batch.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+// 按分组维护COUNT、SUM、AVG,记录可以加入也可以撤销,因此能按增删的记录增量更新
+class GroupAggregator
+{
+public:
+    // 根据SELECT列表和GROUP BY检查聚合查询,select中的列须是分组列或COUNT/SUM/AVG,失败返回false
+    bool init(const vector<pair<string, string>> &tableColumns, const vector<string> &select, const vector<string> &groupBy);
+    void add(const vector<string> &row);
+    void remove(const vector<string> &row);
+    void clear() { groups.clear(); }
+
+    // 结果的列定义(列名,类型)与各行,按分组值排序
+    vector<pair<string, string>> columns() const;
+    RowBatch rows() const;
+
+    // 保存和读取各分组的中间状态(行数、非空值个数与和)
+    bool save(const string &filePath) const;
+    bool load(const string &filePath);
+
+    // SELECT列表中是否含有聚合函数
+    static bool isAggregate(const vector<string> &select);
+
+private:
+    struct Output
+    {
+        string function; // 空表示分组列,否则为count、sum或avg
+        int column = -1; // 分组列为其在分组键中的位置,聚合函数为其在inputs中的位置
+        string name;
+        string type;
+    };
+    struct Input
+    {
+        int column = -1;      // COUNT(*)为-1
+        bool numeric = false; // SUM和AVG只累计能解析为整数的值,COUNT(列)统计全部非空值
+    };
+    struct Group
+    {
+        int64_t rows = 0;
+        vector<int64_t> counts; // 各聚合列的非空值个数
+        vector<int64_t> sums;
+    };
+
+    void apply(const vector<string> &row, int sign);
+
+    vector<int> keyColumns;   // 分组列在表中的下标
+    vector<bool> numericKeys; // 分组列是否为int类型,决定输出顺序
+    vector<Output> outputs;
+    vector<Input> inputs; // 各聚合函数的输入,与Group::counts/sums一一对应
+    map<vector<string>, Group> groups;
+};
+
+class ViewManager
+{
+public:
+    // 创建物化视图:检查定义,登记到目录,扫描一次基表得到初始结果
+    static bool createView(const string &viewName, const string &query);
+    // 丢弃物化视图在内存中的状态并删除其状态文件,不是物化视图时不做任何事
+    static void dropView(const string &viewName);
+    // 扫描基表重新计算物化视图
+    static bool refreshView(const string &viewName);
+
+    // 写入表之前调用,载入依赖该表的物化视图,返回是否需要维护
+    static bool track(const string &tableName);
+    // 表中加入或删除了一条记录,更新依赖它的物化视图
+    static void onInsert(const string &tableName, const vector<string> &row);
+    static void onDelete(const string &tableName, const vector<string> &row);
+    // 一条语句执行完后把改动过的物化视图写回
+    static void commit(const string &tableName);
+
+    // 即席执行聚合查询,whereColumn为空表示全表
+    static bool aggregate(const string &tableName, const vector<string> &select, const vector<string> &groupBy,
+                          const string &whereColumn, const string &whereValue, RowBatch &rows);
+};